@@ -13,6 +13,7 @@
 #include <sstream>
 #include <string>
 
+#include "certificate.h"
 #include "header.h"
 #include "input.h"
 #include "json/json.hpp"
@@ -24,20 +25,6 @@ using json = nlohmann::json;
 
 namespace blockchain {
 
-/*
- * Struct to save the signing key of a signature next to the signature
- */
-struct BlockSignature {
-    std::vector<std::string> signature;
-    signature::SigKey public_key;
-    uint16_t validator_id;
-    uint16_t round;
-
-    friend bool operator==(const BlockSignature& lhs, const BlockSignature& rhs) {
-        return lhs.signature == rhs.signature && lhs.public_key == rhs.public_key && lhs.validator_id == rhs.validator_id && lhs.round == rhs.round;
-    }
-};
-
 class Block {
    public:
     Block(uint64_t id, std::string prevBlockDigest) : header_(blockchain::Header(prevBlockDigest)), id_(id){};
@@ -45,7 +32,11 @@ class Block {
     Block(const chat::Block& proto_block);
 
     // Copy constructor
-    Block(const blockchain::Block& block) : header_(block.getHeader()), txs_(block.getTransactions()), validator_sig_(block.getValidatorSignature()), validator_id_(block.getValidatorID()), validator_next_public_key_(block.getValidatorNextPublicKey()), id_(block.getID()), empty_(block.isEmpty()), mutable_(block.isMutable()), validatorSigs_(block.getValidatorSignatures()){};
+    Block(const blockchain::Block& block) : header_(block.getHeader()), txs_(block.getTransactions()), validator_sig_(block.getValidatorSignature()), validator_id_(block.getValidatorID()), validator_next_public_key_(block.getValidatorNextPublicKey()), id_(block.getID()), empty_(block.isEmpty()), mutable_(block.isMutable()), certificate_(block.getCertificate()){};
+    // Moves hand the transactions & signatures over without copying them
+    Block(blockchain::Block&& block) = default;
+    Block& operator=(const blockchain::Block& block) = default;
+    Block& operator=(blockchain::Block&& block) = default;
 
     ~Block(){};
 
@@ -59,7 +50,21 @@ class Block {
     // Getter for digest (hash)
     // Returns null if block is still mutable
     std::string getDigest();
-    std::string getDigest() const { return getDigest(); };
+    std::string getDigest() const { return const_cast<Block*>(this)->getDigest(); };
+
+    /*
+     * Digest a validator signs for the block with the given hash (header id)
+     * Binds the block, the validator and the next public key it announces
+     * Votes only carry the block hash, so they sign the same digest as the block itself
+     * Signatures made before quorum certificates cover the full next public key instead of its hash,
+     * they don't verify against this digest
+     */
+    static std::string signingDigest(const std::string& block_hash, uint16_t validator_id, const std::string& next_key_hash);
+
+    /*
+     * Returns the hash of the given public key, empty string for an empty key
+     */
+    static std::string keyHash(const signature::SigKey& public_key);
 
     // Getter for header
     // Return null if block is still mutable
@@ -108,9 +113,11 @@ class Block {
         // Convert validator id
         proto_block->set_validatorid(static_cast<uint32_t>(validator_id_));
 
-        // Convert next public key
-        std::string publickey = signature::SigKey_to_string(validator_next_public_key_);
-        proto_block->set_publickey(publickey);
+        // Convert next public key, blocks rebuilt from fragments are not signed
+        if (!validator_next_public_key_.S0.empty()) {
+            std::string publickey = signature::SigKey_to_string(validator_next_public_key_);
+            proto_block->set_publickey(publickey);
+        }
 
         // Convert block ID
         proto_block->set_blockid(id_);
@@ -141,12 +148,26 @@ class Block {
 
         // Read next pub key
         std::string publickey = proto_block.publickey();
-        validator_next_public_key_ = signature::SigKey_from_string(publickey);
+        if (!publickey.empty()) {
+            validator_next_public_key_ = signature::SigKey_from_string(publickey);
+        }
 
         mutable_ = false;
         empty_ = false;
     }
 
+    /*
+     * Serializes the header, id & transactions, without any signature
+     * Used as input of the erasure code
+     */
+    std::string serializeBody() const;
+
+    /*
+     * Reads a body written by serializeBody, the block is immutable afterwards
+     * Returns false if the body cannot be parsed
+     */
+    bool parseBody(const std::string& body);
+
     /*
      * Appends a transaction
      * - Can only add if block is still mutable
@@ -163,6 +184,9 @@ class Block {
     // Verify block & transactions of block
     bool verify(blockchain::UTXOlist& utxolist, std::vector<uint32_t>& receiverIDs);
 
+    // Recalculates the merkle root of the transactions & compares it with the header
+    bool verifyMerkleRoot() const;
+
     // verify whether the new tx is consistent with the existing txs
     bool verifyTxConsist(const blockchain::Transaction& new_tx) const;
 
@@ -185,15 +209,21 @@ class Block {
     signature::SigKey getValidatorNextPublicKey() const { return validator_next_public_key_; };
 
     /*
-     * Returns signature for given validator id
+     * Returns the signatures of the quorum certificate, one per validator
+     */
+    std::vector<BlockSignature> getValidatorSignatures() { return certificate_.getSignatures(); };
+    std::vector<BlockSignature> getValidatorSignatures() const { return certificate_.getSignatures(); };
+
+    /*
+     * Returns the quorum certificate of the block
      */
-    std::vector<BlockSignature> getValidatorSignatures() { return validatorSigs_; };
-    std::vector<BlockSignature> getValidatorSignatures() const { return validatorSigs_; };
+    const QuorumCertificate& getCertificate() const { return certificate_; };
 
     /*
-     * Adds validator signature to signatures list for given validator id
+     * Adds validator signature to the quorum certificate
+     * Keeps one signature per validator, see QuorumCertificate::add
      */
-    void addValidatorSignature(BlockSignature sig) { validatorSigs_.push_back(sig); };
+    void addValidatorSignature(BlockSignature sig) { certificate_.add(sig); };
 
     /*
      * Removes all signatures from block
@@ -202,6 +232,7 @@ class Block {
 
     /*
      * json converters
+     * from_string drops the validator signatures of blocks stored before quorum certificates, they can't be verified
      */
     std::string to_string();
     void from_string(std::string block_string);
@@ -209,9 +240,9 @@ class Block {
    private:
     blockchain::Header header_;
     std::vector<blockchain::Transaction> txs_;
-    std::vector<BlockSignature> validatorSigs_;
+    QuorumCertificate certificate_;
     std::vector<std::string> validator_sig_;
-    uint16_t validator_id_;
+    uint16_t validator_id_ = 0;
     signature::SigKey validator_next_public_key_;
     uint64_t id_;
     bool empty_ = false;
@@ -0,0 +1,117 @@
+#ifndef COSICOIN_INCLUDE_CERTIFICATE_H
+#define COSICOIN_INCLUDE_CERTIFICATE_H
+
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "json/json.hpp"
+#include "signature/hash.h"
+
+using json = nlohmann::json;
+
+// Maximum number of validators that can sign a certificate
+#define MAX_SIGNERS_ 256
+
+// Certificates with fewer checkable signatures are verified on the calling thread, starting threads costs more
+#define PARALLEL_VERIFY_SIGNERS_ 64
+
+namespace blockchain {
+
+/*
+ * Struct to save the signing key of a signature next to the signature
+ * The signed digest is Block::signingDigest(block hash, validator_id, next_key_hash)
+ */
+struct BlockSignature {
+    std::vector<std::string> signature;
+    signature::SigKey public_key;
+    uint16_t validator_id;
+    uint16_t round;
+    std::string next_key_hash = "";  // hash of the next public key announced with the signature
+
+    friend bool operator==(const BlockSignature& lhs, const BlockSignature& rhs) {
+        return lhs.signature == rhs.signature && lhs.public_key == rhs.public_key && lhs.validator_id == rhs.validator_id && lhs.round == rhs.round && lhs.next_key_hash == rhs.next_key_hash;
+    }
+};
+
+/*
+ * Quorum certificate of a block: at most one signature per validator
+ * The signers are kept in a bitmap. Keys are one-time, so every signer has its own key:
+ * only the half of the key the signature does not reveal is stored, the revealed half is the hash of the preimages
+ */
+class QuorumCertificate {
+   public:
+    /*
+     * Adds the signature of sig.validator_id
+     * A validator that already signed is only replaced by a signature with a known public key or a later round
+     * Returns false if the signature was not added or its preimages do not belong to the public key
+     */
+    bool add(const BlockSignature& sig);
+
+    // Returns the number of validators that signed
+    size_t size() const { return signers_.count(); };
+
+    bool empty() const { return signers_.none(); };
+
+    bool hasSigned(uint16_t validator_id) const { return validator_id < MAX_SIGNERS_ && signers_.test(validator_id); };
+
+    std::bitset<MAX_SIGNERS_> getSigners() const { return signers_; };
+
+    /*
+     * Returns the signatures ordered by validator id
+     */
+    std::vector<BlockSignature> getSignatures() const;
+
+    /*
+     * Verifies all signatures for the block with the given hash in one batch
+     * Batches of at least PARALLEL_VERIFY_SIGNERS_ signatures are spread over the available cores
+     * Returns the number of validators with a valid signature
+     */
+    size_t verify(const std::string& block_hash) const;
+
+    /*
+     * Returns true if at least `threshold` validators have a valid signature
+     * Small certificates stop checking once the threshold is reached
+     */
+    bool verify(const std::string& block_hash, size_t threshold) const { return verify_(block_hash, threshold) >= threshold; };
+
+    void clear();
+
+    /*
+     * json converters
+     */
+    json to_json() const;
+    void from_json(const json& j);
+
+    friend bool operator==(const QuorumCertificate& lhs, const QuorumCertificate& rhs) {
+        return lhs.getSignatures() == rhs.getSignatures();
+    }
+
+   private:
+    struct Entry {
+        std::vector<std::string> signature;
+        std::string key_hash;                 // hash of the public key, empty if the key was not known
+        std::vector<std::string> unrevealed;  // key hashes of the preimages that were not revealed
+        std::bitset<KEY_LEN_> revealed;       // set where the signature reveals the S1 preimage
+        uint16_t round;
+        std::string next_key_hash;
+    };
+
+    std::bitset<MAX_SIGNERS_> signers_;
+    std::map<uint16_t, Entry> entries_;  // map<validator id, signature>
+
+    // Rebuilds the public key of a signature with a known key
+    static signature::SigKey publicKey(const Entry& entry);
+
+    // Returns true if the signature of the entry is valid for the block with the given hash
+    static bool verifyEntry(const std::string& block_hash, uint16_t validator_id, const Entry& entry);
+
+    // Counts the valid signatures, a sequential check stops once `enough` are valid
+    size_t verify_(const std::string& block_hash, size_t enough) const;
+};
+
+}  // namespace blockchain
+
+#endif
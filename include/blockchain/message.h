@@ -6,9 +6,12 @@
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 
+#include <functional>
+
 #include "block.h"
 #include "transaction.h"
 #include "utxo.h"
+#include "vote.h"
 
 namespace blockchain {
 
@@ -16,6 +19,19 @@ enum MsgType { ECHO,
                SEND,
                READY };
 
+/*
+ * Erasure coded fragment of a block with its merkle proof
+ * The root commits to all fragments of the block, the proof to this fragment
+ */
+struct Fragment {
+    uint16_t index = 0;
+    std::string data;
+    std::string root;
+    std::vector<std::string> proof;
+
+    bool isEmpty() const { return root.empty(); };
+};
+
 class Message {
    public:
     /*
@@ -27,10 +43,27 @@ class Message {
      */
     Message(MsgType type, const blockchain::Block& block, uint64_t sender_id, uint16_t round)
         : type_(type), block_(block), sender_id_(sender_id), round_(round), empty_(false) {}
+    /*
+     * Constructor for a message belonging to the broadcast instance <proposer_id, sequence>
+     */
+    Message(MsgType type, const blockchain::Block& block, uint64_t sender_id, uint16_t round, uint16_t proposer_id, uint64_t sequence)
+        : type_(type), block_(block), sender_id_(sender_id), round_(round), proposer_id_(proposer_id), sequence_(sequence), empty_(false) {}
+    /*
+     * Constructor for an ECHO or READY vote of the broadcast instance <proposer_id, sequence>
+     * The message only carries the signed block hash, not the block
+     */
+    Message(MsgType type, const blockchain::Vote& vote, uint64_t sender_id, uint16_t round, uint16_t proposer_id, uint64_t sequence)
+        : type_(type), vote_(vote), sender_id_(sender_id), round_(round), proposer_id_(proposer_id), sequence_(sequence), empty_(false) {}
     /*
      * Constructor to make message from proto message
      */
-    Message(const chat::Message& proto_message) {  // Don't move this implementation to message.cc because otherwise the ghosts in the ESAT computers will hide it from the compiler when linking it to an executable
+    Message(const chat::Message& proto_message) : Message(proto_message, nullptr){};
+    /*
+     * Constructor to make message from proto message, skipping the body of blocks that are known already
+     * A block for which `known_block` returns true on its hash is read as the vote of the validator that signed it,
+     * only the header & signature fields are read. hasKnownBlock() tells these messages apart
+     */
+    Message(const chat::Message& proto_message, const std::function<bool(const std::string&)>& known_block) {  // Don't move this implementation to message.cc because otherwise the ghosts in the ESAT computers will hide it from the compiler when linking it to an executable
         uint32_t proto_type = proto_message.type();
         if (proto_type == 0) {
             type_ = MsgType::ECHO;
@@ -41,8 +74,31 @@ class Message {
         }
         sender_id_ = proto_message.sender_id();
         round_ = proto_message.round();
+        proposer_id_ = static_cast<uint16_t>(proto_message.proposer_id());
+        sequence_ = proto_message.sequence();
         empty_ = false;
-        block_.fromProtoBlock(proto_message.block());
+        if (proto_message.has_block()) {
+            const chat::Block& proto_block = proto_message.block();
+            std::string blk_hash = blockchain::Header(proto_block.header()).getID();
+            if (known_block && known_block(blk_hash)) {
+                vote_ = blockchain::Vote(blk_hash, proto_block);
+                known_block_ = true;
+            } else {
+                block_.fromProtoBlock(proto_block);
+            }
+        }
+        if (proto_message.has_vote()) {
+            vote_ = blockchain::Vote(proto_message.vote());
+        }
+        if (proto_message.has_fragment()) {
+            const chat::Fragment& proto_fragment = proto_message.fragment();
+            fragment_.index = static_cast<uint16_t>(proto_fragment.index());
+            fragment_.data = proto_fragment.data();
+            fragment_.root = proto_fragment.root();
+            for (int i = 0; i < proto_fragment.proof_size(); i++) {
+                fragment_.proof.push_back(proto_fragment.proof(i));
+            }
+        }
     };
     //~Message();
 
@@ -50,12 +106,33 @@ class Message {
 
     int setType(const MsgType type_message);
 
+    // Returns the block, empty block for a vote message
     const blockchain::Block& getBlock() const { return block_; };
 
+    // Returns the vote, empty vote for a message that carries a block
+    const blockchain::Vote& getVote() const { return vote_; };
+
+    // Returns true if the message only carries a vote
+    bool isVote() const { return !vote_.isEmpty(); };
+
+    // Returns true if the message carried a known block that was read as a vote of its signer
+    bool hasKnownBlock() const { return known_block_; };
+
+    // Returns the erasure coded fragment, empty fragment if the message has none
+    const blockchain::Fragment& getFragment() const { return fragment_; };
+
+    void setFragment(const blockchain::Fragment& fragment) { fragment_ = fragment; };
+
     int getSenderId() const { return sender_id_; };
 
     int getRound() const { return round_; };
 
+    // Returns the id of the validator that proposed the block of this broadcast instance
+    uint16_t getProposerId() const { return proposer_id_; };
+
+    // Returns the sequence number the proposer gave to this broadcast instance
+    uint64_t getSequence() const { return sequence_; };
+
     bool isEmpty() const { return empty_; };
 
     friend std::ostream& operator<<(std::ostream& o, const Message& m);
@@ -76,11 +153,27 @@ class Message {
             proto_message.set_type(2);
         }
 
-        chat::Block* proto_block = proto_message.mutable_block();
-        block_.toProtoBlock(proto_block);
+        if (!block_.isEmpty()) {
+            chat::Block* proto_block = proto_message.mutable_block();
+            block_.toProtoBlock(proto_block);
+        }
+        if (!vote_.isEmpty()) {
+            vote_.toProtoVote(proto_message.mutable_vote());
+        }
+        if (!fragment_.isEmpty()) {
+            chat::Fragment* proto_fragment = proto_message.mutable_fragment();
+            proto_fragment->set_index(fragment_.index);
+            proto_fragment->set_data(fragment_.data);
+            proto_fragment->set_root(fragment_.root);
+            for (const std::string& hash : fragment_.proof) {
+                proto_fragment->add_proof(hash);
+            }
+        }
 
         proto_message.set_sender_id(sender_id_);
         proto_message.set_round(round_);
+        proto_message.set_proposer_id(proposer_id_);
+        proto_message.set_sequence(sequence_);
 
         return proto_message;
     };
@@ -88,9 +181,14 @@ class Message {
    private:
     MsgType type_;
     blockchain::Block block_;
+    blockchain::Vote vote_;
+    blockchain::Fragment fragment_;
     uint64_t sender_id_;
     uint32_t round_;
+    uint16_t proposer_id_ = 0;
+    uint64_t sequence_ = 0;
     bool empty_;
+    bool known_block_ = false;
 };
 
 }  // namespace blockchain
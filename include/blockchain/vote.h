@@ -0,0 +1,106 @@
+#ifndef COSICOIN_INCLUDE_VOTE_H
+#define COSICOIN_INCLUDE_VOTE_H
+
+#include <chat.grpc.pb.h>
+#include <grpcpp/ext/proto_server_reflection_plugin.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/health_check_service_interface.h>
+
+#include <string>
+#include <vector>
+
+#include "block.h"
+#include "signature/hash.h"
+
+namespace blockchain {
+
+/*
+ * Signed ECHO or READY vote of a validator for a block
+ * Only carries the hash (header id) of the block, not the block itself
+ */
+class Vote {
+   public:
+    /*
+     * Constructor to make empty vote
+     */
+    Vote() : empty_(true){};
+    /*
+     * Constructor to make an unsigned vote for the block with the given hash
+     */
+    Vote(const std::string& block_hash) : block_hash_(block_hash), empty_(false){};
+    /*
+     * Constructor to make vote from proto vote
+     */
+    Vote(const chat::Vote& proto_vote) {
+        block_hash_ = proto_vote.blockhash();
+        for (int i = 0; i < proto_vote.validatorsig_size(); i++) {
+            validator_sig_.push_back(proto_vote.validatorsig(i));
+        }
+        validator_id_ = static_cast<uint16_t>(proto_vote.validatorid());
+        validator_next_public_key_ = signature::SigKey_from_string(proto_vote.publickey());
+        empty_ = false;
+    };
+    /*
+     * Constructor to make the vote of the validator that signed the given proto block
+     * Only reads the signature fields, the transactions are not decoded
+     */
+    Vote(const std::string& block_hash, const chat::Block& proto_block) {
+        block_hash_ = block_hash;
+        for (int i = 0; i < proto_block.validatorsig_size(); i++) {
+            validator_sig_.push_back(proto_block.validatorsig(i));
+        }
+        validator_id_ = static_cast<uint16_t>(proto_block.validatorid());
+        if (!proto_block.publickey().empty()) {
+            validator_next_public_key_ = signature::SigKey_from_string(proto_block.publickey());
+        }
+        empty_ = false;
+    };
+
+    const std::string& getBlockHash() const { return block_hash_; };
+
+    std::vector<std::string> getValidatorSignature() const { return validator_sig_; };
+
+    uint16_t getValidatorID() const { return validator_id_; };
+
+    signature::SigKey getValidatorNextPublicKey() const { return validator_next_public_key_; };
+
+    bool isEmpty() const { return empty_; };
+
+    /*
+     * Returns the digest that is signed by the validator
+     * Same digest as a block with this hash signed by the same validator
+     */
+    std::string getDigest() const {
+        return Block::signingDigest(block_hash_, validator_id_, Block::keyHash(validator_next_public_key_));
+    };
+
+    /*
+     * Signs the vote with the given signature
+     * Overwrites the existing signature
+     */
+    void sign(signature::SigKey signing_key, uint16_t validator_id, signature::SigKey next_public_key);
+
+    bool verifySignature(signature::SigKey public_key) const;
+
+    /*
+     * Converts itself to a proto buffer vote
+     */
+    inline void toProtoVote(chat::Vote* proto_vote) const {
+        proto_vote->set_blockhash(block_hash_);
+        for (const std::string& sig : validator_sig_) {
+            proto_vote->add_validatorsig(sig);
+        }
+        proto_vote->set_validatorid(static_cast<uint32_t>(validator_id_));
+        proto_vote->set_publickey(signature::SigKey_to_string(validator_next_public_key_));
+    }
+
+   private:
+    std::string block_hash_;
+    std::vector<std::string> validator_sig_;
+    uint16_t validator_id_ = 0;
+    signature::SigKey validator_next_public_key_;
+    bool empty_;
+};
+
+}  // namespace blockchain
+#endif
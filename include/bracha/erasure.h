@@ -0,0 +1,51 @@
+#ifndef COSICOIN_INCLUDE_ERASURE_H
+#define COSICOIN_INCLUDE_ERASURE_H
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Maximum number of fragments, every fragment needs a distinct element of GF(2^8)
+#define MAX_FRAGMENTS_ 256
+
+namespace bracha {
+
+/*
+ * Systematic Reed-Solomon code over GF(2^8)
+ * Splits data in `data_fragments` (k) fragments & adds parity fragments up to `total_fragments` (n)
+ * The data can be recovered from any k of the n fragments
+ */
+class ErasureCode {
+   public:
+    /*
+     * Throws std::invalid_argument if k is 0, k > n or n > MAX_FRAGMENTS_
+     */
+    ErasureCode(uint16_t data_fragments, uint16_t total_fragments);
+
+    /*
+     * Returns the n fragments of `data`, all of the same size
+     * The first k fragments hold the length prefixed data, the others parity
+     */
+    std::vector<std::string> encode(const std::string& data) const;
+
+    /*
+     * Recovers the data from at least k fragments in a map<fragment index, fragment>
+     * Returns false if there are not enough fragments or the fragments are malformed
+     */
+    bool decode(const std::map<uint16_t, std::string>& fragments, std::string& data) const;
+
+    uint16_t getDataFragments() const { return k_; };
+    uint16_t getTotalFragments() const { return n_; };
+
+   private:
+    uint16_t k_;
+    uint16_t n_;
+    // parity_[i][j]: coefficient of data fragment j in parity fragment k + i
+    std::vector<std::vector<uint8_t>> parity_;
+};
+
+}  // namespace bracha
+
+#endif
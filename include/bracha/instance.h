@@ -0,0 +1,48 @@
+#ifndef COSICOIN_INCLUDE_INSTANCE_H
+#define COSICOIN_INCLUDE_INSTANCE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "blockchain/message.h"
+#include "bracha/votes.h"
+
+namespace bracha {
+
+/*
+ * Identifies one reliable broadcast instance: the block proposed by `proposer` under sequence number `sequence`
+ * Sequence numbers of a proposer start at 1
+ */
+struct InstanceID {
+    uint16_t proposer;
+    uint64_t sequence;
+
+    friend bool operator==(const InstanceID& lhs, const InstanceID& rhs) {
+        return lhs.proposer == rhs.proposer && lhs.sequence == rhs.sequence;
+    }
+
+    friend bool operator<(const InstanceID& lhs, const InstanceID& rhs) {
+        if (lhs.proposer != rhs.proposer) {
+            return lhs.proposer < rhs.proposer;
+        }
+        return lhs.sequence < rhs.sequence;
+    }
+};
+
+/*
+ * Protocol state of one reliable broadcast instance
+ */
+struct Instance {
+    std::string send_hash = "";                       // block received in the SEND of this instance
+    bool echo_sent = false;                           // ECHO sent for send_hash
+    bool ready_sent = false;                          // READY sent for this instance
+    bool delivered = false;                           // block of this instance delivered
+    VoteTracker votes;                                // ECHO & READY voters per block hash
+    blockchain::Fragment fragment;                    // own fragment received in a coded SEND, forwarded in the ECHO
+    std::map<std::string, std::map<uint16_t, std::string>> fragments;  // map<merkle root, map<index, fragment>>
+};
+
+}  // namespace bracha
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef COSICOIN_INCLUDE_MERKLE_H
+#define COSICOIN_INCLUDE_MERKLE_H
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "signature/hash.h"
+
+namespace bracha {
+
+/*
+ * Merkle tree over erasure coded fragments
+ * Lets a validator prove that its fragment belongs to the fragments the proposer committed to
+ * Like the merkle root of the block header, the last node of a level is duplicated if the level is odd
+ */
+class MerkleTree {
+   public:
+    MerkleTree(const std::vector<std::string>& leaves);
+
+    std::string getRoot() const { return levels_.back()[0]; };
+
+    /*
+     * Returns the sibling hashes on the path from leaf `index` to the root
+     */
+    std::vector<std::string> getProof(size_t index) const;
+
+    /*
+     * Checks that `leaf` is leaf `index` of the tree with the given root
+     */
+    static bool verify(const std::string& root, size_t index, const std::string& leaf, const std::vector<std::string>& proof);
+
+    size_t size() const { return leaf_count_; };
+
+   private:
+    size_t leaf_count_;
+    // levels_[0] holds the leaf hashes, levels_.back() the root
+    std::vector<std::vector<std::string>> levels_;
+};
+
+}  // namespace bracha
+
+#endif
@@ -4,10 +4,16 @@
 #include <math.h>
 #include <stdbool.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <set>
 #include <string>
@@ -17,7 +23,11 @@
 
 #include "blockchain/block.h"
 #include "blockchain/message.h"
+#include "blockchain/vote.h"
+#include "bracha/erasure.h"
+#include "bracha/instance.h"
 #include "bracha/logging.h"
+#include "bracha/merkle.h"
 #include "comms/client.h"
 #include "comms/server.h"
 #include "config/settings.h"
@@ -25,89 +35,146 @@
 
 namespace bracha {
 
+/*
+ * A block accepted by consensus, handed out once
+ */
+struct DeliveredBlock {
+    InstanceID instance;   // proposer & sequence number of the proposer
+    uint64_t height;       // position in the delivery order of this node, starting at 1
+    blockchain::Block block;
+};
+
+/*
+ * A delivered block compacted to what proves its delivery
+ */
+struct CompactedBlock {
+    uint64_t height;                           // delivery height
+    std::string hash;                          // block hash (header id)
+    blockchain::QuorumCertificate certificate;
+};
+
+/*
+ * Number of entries in the consensus bookkeeping of a node
+ */
+struct NodeGauges {
+    size_t instances;       // open broadcast instances
+    size_t blocks;          // blocks held in full, delivered or not
+    size_t compacted;       // delivered blocks compacted to digest & certificate
+    size_t pending_sigs;    // blocks with signatures waiting for the block
+    size_t verified;        // hashes of verified blocks
+};
+
 class Node {
    public:
     Node(const std::string& name, uint16_t id, config::Settings settings, comms::ChatServiceImpl* server, std::mutex* io_mutex, bool is_lead = false) : name_(name), id_(id), is_faulty_(false), is_lead_(is_lead), grpcServer_(server), grpcClient_(settings), my_next_key_pair_(signature::Signature::getInstance()), mutex_io_(io_mutex) {
-        send_this_round_ = "";
         port_ = settings.getValidatorInfo(id).port;
-        cond_grpc_ = server->getConditionVariable();
         my_next_key_pair_.KeyGen();
         n_ = settings.getTotalNumberOfValidators();
         f_ = settings.getNumberOfFaultyValidators();
+        pipeline_depth_ = std::max<uint32_t>(1, settings.getPipelineDepth());
+        erasure_coding_ = settings.getErasureCoding();
+        gc_watermark_ = std::max<uint32_t>(1, settings.getGcWatermark());
     }
     // Copy constructor
     Node(const Node& other) : name_(other.name_),
                               id_(other.id_),
                               grpcServer_(other.grpcServer_),
                               grpcClient_(other.grpcClient_),
-                              cond_grpc_(other.cond_grpc_),
                               mutex_io_(other.mutex_io_),
                               is_faulty_(other.is_faulty_),
                               port_(other.port_),
                               is_lead_(other.is_lead_),
-                              blk_list_(other.blk_list_),
-                              send_this_round_(other.send_this_round_),
-                              ready_this_round_(other.ready_this_round_),
-                              echo_this_round_(other.echo_this_round_),
-                              ready_sent_(other.ready_sent_),
+                              n_(other.n_),
+                              f_(other.f_),
+                              pipeline_depth_(other.pipeline_depth_),
+                              erasure_coding_(other.erasure_coding_),
+                              gc_watermark_(other.gc_watermark_),
+                              instances_(other.instances_),
+                              next_delivery_(other.next_delivery_),
+                              delivered_(other.delivered_),
+                              next_sequence_(other.next_sequence_),
                               utxolist_(other.utxolist_),
                               wallet_ids_(other.wallet_ids_),
                               voted_hash_(other.voted_hash_),
-                              should_broadcast_(other.should_broadcast_),
+                              running_(other.running_.load()),
                               my_current_private_key_(other.my_current_private_key_),
                               my_current_public_key_(other.my_current_public_key_),
                               my_next_key_pair_(other.my_next_key_pair_),
                               val_sig_keys_(other.val_sig_keys_),
                               verified_blocks_(other.verified_blocks_),
                               blocks_(other.blocks_),
-                              accepted_blocks_(other.accepted_blocks_) {}
+                              pending_sigs_(other.pending_sigs_),
+                              accepted_blocks_(other.accepted_blocks_),
+                              accepted_count_(other.accepted_count_.load()),
+                              delivered_height_(other.delivered_height_),
+                              seen_(other.seen_),
+                              delivered_log_(other.delivered_log_),
+                              compacted_(other.compacted_) {}
 
     // // Move constructor
     Node(Node&& other) noexcept : name_(std::move(other.name_)),
                                   id_(std::move(other.id_)),
                                   grpcServer_(std::move(other.grpcServer_)),
                                   grpcClient_(std::move(other.grpcClient_)),
-                                  cond_grpc_(std::move(other.cond_grpc_)),
                                   mutex_io_(std::move(other.mutex_io_)),
                                   is_faulty_(std::move(other.is_faulty_)),
                                   port_(std::move(other.port_)),
                                   is_lead_(std::move(other.is_lead_)),
-                                  blk_list_(std::move(other.blk_list_)),
-                                  send_this_round_(std::move(other.send_this_round_)),
-                                  ready_this_round_(std::move(other.ready_this_round_)),
-                                  echo_this_round_(std::move(other.echo_this_round_)),
-                                  ready_sent_(std::move(other.ready_sent_)),
+                                  n_(other.n_),
+                                  f_(other.f_),
+                                  pipeline_depth_(other.pipeline_depth_),
+                                  erasure_coding_(other.erasure_coding_),
+                                  gc_watermark_(other.gc_watermark_),
+                                  instances_(std::move(other.instances_)),
+                                  next_delivery_(std::move(other.next_delivery_)),
+                                  delivered_(std::move(other.delivered_)),
+                                  next_sequence_(other.next_sequence_),
                                   utxolist_(std::move(other.utxolist_)),
                                   wallet_ids_(std::move(other.wallet_ids_)),
                                   voted_hash_(std::move(other.voted_hash_)),
-                                  should_broadcast_(std::move(other.should_broadcast_)),
+                                  running_(other.running_.load()),
                                   my_current_private_key_(std::move(other.my_current_private_key_)),
                                   my_current_public_key_(std::move(other.my_current_public_key_)),
                                   my_next_key_pair_(std::move(other.my_next_key_pair_)),
                                   val_sig_keys_(std::move(other.val_sig_keys_)),
                                   verified_blocks_(std::move(other.verified_blocks_)),
                                   blocks_(std::move(other.blocks_)),
-                                  accepted_blocks_(std::move(other.accepted_blocks_)) {}
+                                  pending_sigs_(std::move(other.pending_sigs_)),
+                                  accepted_blocks_(std::move(other.accepted_blocks_)),
+                                  accepted_count_(other.accepted_count_.load()),
+                                  delivered_height_(other.delivered_height_),
+                                  seen_(std::move(other.seen_)),
+                                  delivered_log_(std::move(other.delivered_log_)),
+                                  compacted_(std::move(other.compacted_)) {}
 
     ~Node() {
-        should_broadcast_ = false;
-        ready_this_round_.clear();
-        echo_this_round_.clear();
-        send_this_round_ = "";
+        running_ = false;
+        instances_.clear();
+        delivered_.clear();
     }
 
     /**
      * @brief runs the bracha protocol
      *
+     * Keeps running every broadcast instance until Stop() is called,
+     * delivered blocks can be collected with getConsensusBlocks().
+     * Returns right away if the node was stopped before the loop started.
+     *
      * @param
      * @return
      */
     void RunProtocol(bool broadcast);
 
+    /*
+     * Stops the protocol loop of RunProtocol
+     */
+    void Stop();
+
     /*
      * Updates the utxolists in the server
      */
     void setUTXOlists(blockchain::UTXOlist utxolist, std::vector<uint32_t> wallet_ids) {
+        std::lock_guard<std::mutex> lock(mutex_utxo_);
         utxolist_ = utxolist;
         wallet_ids_ = wallet_ids;
     }
@@ -115,7 +182,10 @@ class Node {
     /*
      * Clears all saved utxolists
      */
-    void clearUTXOlists() { utxolist_.clear(); }
+    void clearUTXOlists() {
+        std::lock_guard<std::mutex> lock(mutex_utxo_);
+        utxolist_.clear();
+    }
 
     /**
      * @brief check whether the node is a leader or not.
@@ -127,15 +197,69 @@ class Node {
     inline virtual bool isLeader() const { return is_lead_; }
 
     /**
-     * @brief check whether the node has accepted any nodes yet.
+     * @brief check whether the node has accepted blocks that are not collected yet.
      *
      * @param
      * @return false the node did not accept.
      * @return true the node accepted.
      */
-    inline bool isConsensus() const {
+    inline bool isConsensus() const { return accepted_count_ > 0; }
+
+    typedef std::function<void(DeliveredBlock&&)> DeliveryHandler;
+
+    /*
+     * Hands every block accepted from now on to `handler` instead of the accepted blocks of getConsensusBlocks()
+     * The handler runs on the consensus thread in delivery order, outside of the node's locks,
+     * it should pass the block on rather than block the protocol. nullptr restores getConsensusBlocks()
+     * Handlers are not copied with the node
+     */
+    void setDeliveryHandler(DeliveryHandler handler) {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        delivery_handler_ = handler;
+    }
+
+    typedef std::function<void(const InstanceID&, blockchain::Block&&)> AbandonHandler;
+
+    /*
+     * Hands the block of every instance abandoned from now on to `handler`, e.g. so the proposer gets the transactions back
+     * Only blocks this node holds are handed out, i.e. always the own proposals. Runs like the delivery handler
+     */
+    void setAbandonHandler(AbandonHandler handler) {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        abandon_handler_ = handler;
+    }
+
+    /*
+     * Blocks until accepted blocks wait for getConsensusBlocks(), wakeDelivery() or Stop() is called
+     * or `timeout_ms` passed (-1 waits forever)
+     * Returns true if accepted blocks are waiting
+     */
+    bool waitDelivery(int timeout_ms = -1);
+
+    /*
+     * Wakes up the threads waiting in waitDelivery(), e.g. to let them stop
+     */
+    void wakeDelivery();
+
+    /*
+     * Returns true while the protocol loop is running
+     */
+    inline bool isRunning() const { return running_; }
+
+    /*
+     * Returns the sizes of the consensus bookkeeping, bounded by the gc watermark
+     */
+    NodeGauges getGauges() const {
         std::lock_guard<std::mutex> lock(mutex_cons_);
-        return !should_broadcast_;
+        return NodeGauges{instances_.size(), blocks_.size(), compacted_.size(), pending_sigs_.size(), verified_blocks_.size()};
+    }
+
+    /*
+     * Returns the delivered blocks that were compacted to digest & certificate, oldest first
+     */
+    std::vector<CompactedBlock> getCompactedBlocks() const {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        return std::vector<CompactedBlock>(compacted_.begin(), compacted_.end());
     }
 
     inline std::string getName() const { return this->name_; }
@@ -143,10 +267,15 @@ class Node {
     inline uint64_t getId() const { return this->id_; }
 
     inline std::string getVotedHash() const {
-        std::lock_guard<std::mutex> lock(mutex_cons_);
+        std::lock_guard<std::mutex> lock(mutex_voted_);
         return voted_hash_;
     }
 
+    /*
+     * Returns the accepted blocks in delivery order
+     * Removes them from the accepted list if erase is true
+     * The blocks are copied outside of the consensus lock
+     */
     std::vector<blockchain::Block> getConsensusBlocks(bool erase = false);
 
     /*
@@ -171,15 +300,29 @@ class Node {
 
    protected:
     /**
-     * @brief broadcast <TYPE, block> to all the existing nodes.
+     * @brief broadcast <TYPE, block> of the given instance to all the existing nodes.
      *
      * @param a messgae
      * @return
      */
-    virtual void broadcastMessage(blockchain::MsgType type, blockchain::Block block, uint16_t round);
+    virtual void broadcastMessage(blockchain::MsgType type, blockchain::Block block, uint16_t round, InstanceID instance);
+
+    /**
+     * @brief broadcast a signed vote <TYPE, block hash> of the given instance to all the existing nodes.
+     *
+     * Used for ECHO & READY, the block itself is only sent in the SEND
+     */
+    virtual void broadcastVote(blockchain::MsgType type, const std::string& blk_hash, uint16_t round, InstanceID instance, const blockchain::Fragment& fragment = blockchain::Fragment());
 
     /**
-     * @brief performs the protocol actions of the current round.
+     * @brief sends a coded SEND of the block to every node, node i only gets fragment i.
+     *
+     * The block can be rebuilt from the fragments of any n - 2f nodes
+     */
+    void broadcastFragments(const blockchain::Block& block, InstanceID instance);
+
+    /**
+     * @brief performs the protocol actions of the current round for every open instance.
      *
      * @param current round
      * @return
@@ -190,33 +333,198 @@ class Node {
     // update the data structures
     void updateRecvMessages(const std::vector<blockchain::Message> msg_list);
 
+    /*
+     * Marks the instance as delivered and moves every block that can be delivered
+     * in sequence order of its proposer to the accepted blocks
+     * An empty hash abandons the instance: it frees its sequence & pipeline slot without accepting a block
+     * Needs mutex_cons_
+     */
+    void deliver(const InstanceID& instance, const std::string& blk_hash);
+
+    /*
+     * Passes the blocks collected by deliver() to the delivery handler, called without mutex_cons_
+     */
+    void handDeliveries();
+
+    /*
+     * Returns true if messages of the instance are no longer needed: it is delivered already,
+     * or it lies more than a gc watermark beyond the pipeline of its proposer
+     * Needs mutex_cons_
+     */
+    bool isStale(const InstanceID& instance) const;
+
+    /*
+     * Remembers the instance a block or vote hash was seen in, so it expires if the instance passes without delivering it
+     * Needs mutex_cons_
+     */
+    void markSeen(const InstanceID& instance, const std::string& blk_hash);
+
+    /*
+     * Returns true if the block is delivered, or proposed or voted for in an instance that is not delivered yet
+     * Such a block must not expire with the instance it was seen in, e.g. a vote of a faulty node naming it under another instance
+     * Needs mutex_cons_
+     */
+    bool isBlockInUse(const std::string& blk_hash) const;
+
+    /*
+     * Returns true if the block is delivered, held in full or compacted
+     * Needs mutex_cons_
+     */
+    bool isDeliveredBlock(const std::string& blk_hash) const;
+
+    /*
+     * Returns true if the block is delivered or the SEND of an instance other than `instance` proposed it
+     * A SEND of such a block is refused, so no block is delivered twice
+     * Needs mutex_cons_
+     */
+    bool isBoundBlock(const std::string& blk_hash, const InstanceID& instance) const;
+
+    /*
+     * Compacts the delivered blocks that are a gc watermark behind the delivery height to digest & certificate,
+     * and evicts compacted blocks a second watermark later
+     * Accepted blocks that were not collected by getConsensusBlocks() yet are kept in full
+     * Needs mutex_cons_
+     */
+    void collectGarbage();
+
+    /*
+     * Returns the next sequence number of the given proposer that still has to be delivered
+     * Needs mutex_cons_
+     */
+    uint64_t nextDelivery(uint16_t proposer) const;
+
+    /*
+     * Sets running_ as a protocol loop starts, unless Stop() was called before
+     * Returns running_
+     */
+    bool startRunning(bool run);
+
+    /*
+     * Runs the protocol loop & the fetch thread until Stop() is called
+     */
+    void runLoop();
+
+    /*
+     * Waits for consensus messages of the server & processes them
+     * Returns false if the wait was woken up without new messages, e.g. by Stop()
+     */
     bool RunTaskInWait();
 
     /*
      * Copies next private sigkey to current private sigkey
      * Creates new next sigkey
+     * Returns the new next public sigkey
+     */
+    signature::SigKey rotateKeys();
+
+    /*
      * Puts next public sigkey in block
      * Signs block with current sigkey
      */
     void signBlock(blockchain::Block& block);
 
-    // bool verifyBlock(blockchain::Block& block);
+    /*
+     * Puts next public sigkey in vote
+     * Signs vote with current sigkey
+     */
+    void signVote(blockchain::Vote& vote);
 
     /*
-     * Checks the signature of the block & stores the next sigkey
+     * Checks the signature of `digest` by sig.validator_id & stores the next sigkey
+     * Fills in the public key of sig that was used to check the signature
      * Returns true if signature is valid, false otherwise
      */
-    bool checkBlockSig(const blockchain::Block block);
+    bool checkSig(const std::string& digest, blockchain::BlockSignature& sig, const signature::SigKey& next_public_key);
+
+    /*
+     * Checks the merkle root & the transactions of the block against the utxolist
+     * Returns true if the block is valid
+     */
+    bool verifyBlock(blockchain::Block& block);
+
+    /*
+     * Stores a received block & attaches the signatures that arrived before it
+     * Needs mutex_cons_
+     */
+    void storeBlock(const std::string& blk_hash, const blockchain::Block& block);
+
+    /*
+     * Adds the signature to the block, or keeps it until the block is received
+     * Needs mutex_cons_
+     */
+    void addSignature(const std::string& blk_hash, const blockchain::BlockSignature& sig);
+
+    /*
+     * Returns the erasure code of the coded SEND: n fragments of which n - 2f are needed
+     */
+    ErasureCode erasureCode() const { return ErasureCode(std::max(1, n_ - 2 * f_), n_); };
+
+    /*
+     * Checks the merkle proof of a fragment of the given validator & adds it to the instance
+     */
+    bool addFragment(Instance& state, const blockchain::Fragment& fragment, uint16_t validator_id);
+
+    enum class Rebuild { REBUILT,      // a valid block with the given hash was rebuilt & stored
+                         INCOMPLETE,   // not enough usable fragments yet, the block may still be fetched
+                         INVALID };    // the fragments of the proposer decode to a block that can never be delivered
+
+    /*
+     * Rebuilds the block from the fragments received in the instance
+     * Any n - 2f fragments of a root include one of a correct validator, so a root with enough fragments
+     * that doesn't decode to a valid block with the given hash comes from a faulty proposer
+     */
+    Rebuild reconstructBlock(const std::string& blk_hash, const Instance& state);
+
+    /*
+     * Queues a fetch of a block that was missed in the SEND, the validators that voted for it are asked
+     * The fetch thread stores the block & wakes up the consensus thread, a block already queued is not queued again
+     */
+    void requestFetch(const std::string& blk_hash, const VoteTracker& votes);
+
+    /*
+     * Runs the queued fetches one after the other until the protocol stops, so the consensus thread never waits for a peer
+     */
+    void RunFetches();
+
+    /*
+     * Requests a block from the given validators in turn
+     * Returns true if a valid block was received & stored
+     */
+    bool fetchBlock(const std::string& blk_hash, const std::vector<uint16_t>& candidates);
+
+    /*
+     * Answers block fetches of other validators
+     */
+    bool provideBlock(const std::string& blk_hash, blockchain::Block& block);
+
+    /*
+     * Returns true if the block is verified & not delivered, the decode threads skip its body then
+     */
+    bool isKnownBlock(const std::string& blk_hash) const;
 
    protected:
     // Includes two instances of the chat client and chat servers.
     comms::ChatServiceImpl* grpcServer_;
     comms::ValidatorClientImpl grpcClient_;
 
-    std::condition_variable* cond_grpc_;
     std::mutex mutex_grpc_;
     std::mutex* mutex_io_;
     mutable std::mutex mutex_cons_;
+    mutable std::mutex mutex_voted_;  // guards voted_hash_ only, so observers don't wait for the consensus thread
+    std::mutex mutex_utxo_;
+    std::condition_variable cond_pipeline_;  // notified when an instance is delivered or the protocol stops
+    uint64_t delivery_wakeups_ = 0;          // counts wakeDelivery() & Stop() calls, guarded by mutex_cons_
+
+    // Blocks fetched from peers, off the consensus thread
+    struct FetchRequest {
+        std::string blk_hash;
+        std::vector<uint16_t> candidates;  // validators that voted for the block, asked in turn
+    };
+    std::mutex mutex_fetch_;
+    std::condition_variable cond_fetch_;      // notified when a fetch is queued or the protocol loop ends
+    std::deque<FetchRequest> fetch_queue_;    // guarded by mutex_fetch_
+    std::set<std::string> fetching_;          // hashes queued or in flight, guarded by mutex_fetch_
+    std::atomic<bool> fetched_{false};        // a fetched block waits for the next broadcast round
 
    protected:
     std::string name_;
@@ -227,25 +535,41 @@ class Node {
     bool is_lead_;
     uint16_t n_;
     uint16_t f_;
-
-    std::unordered_map<std::string, blockchain::Block> blk_list_;
-    std::string send_this_round_ = "";                            // list<block_hash>
-    std::unordered_map<std::string, uint64_t> ready_this_round_;  // map<block_hash, list<node_id>>
-    std::unordered_map<std::string, uint64_t> echo_this_round_;   // map<block_hash, list<node_id>>
-    std::set<std::string> ready_sent_;                            // list<block_hash>
+    uint32_t pipeline_depth_ = 1;  // max number of own undelivered instances
+    bool erasure_coding_ = false;  // disperse blocks in erasure coded fragments
+    uint32_t gc_watermark_ = 128;  // number of delivered blocks kept in full
+
+    std::map<InstanceID, Instance> instances_;       // state of every open broadcast instance
+    std::map<uint16_t, uint64_t> next_delivery_;     // map<proposer, next sequence to deliver>
+    std::map<InstanceID, std::string> delivered_;    // delivered out of order, waiting for the previous sequences, empty if abandoned
+    uint64_t next_sequence_ = 1;                     // sequence number of the next own proposal
     blockchain::UTXOlist utxolist_;
     std::vector<uint32_t> wallet_ids_;
 
     std::string voted_hash_;
-    bool should_broadcast_ = true;
+    std::atomic<bool> running_{false};  // written under mutex_cons_ by Stop() so waiters on cond_pipeline_ see it
+    bool stopped_ = false;              // set by Stop(), a protocol loop that starts afterwards returns right away, guarded by mutex_cons_
 
     signature::SigKey my_current_private_key_;
     signature::SigKey my_current_public_key_;
     signature::Signature my_next_key_pair_;
     std::unordered_map<uint16_t, signature::SigKey> val_sig_keys_;  // map<node_id, val_sig_pub_key> stores the next public signing key of each validator
     std::set<std::string> verified_blocks_;                         // stores the hash of each verified block
-    std::unordered_map<std::string, blockchain::Block> blocks_;     // map<block_id, block> stores all received blocks with all their signatures
-    std::vector<std::string> accepted_blocks_;                      // stores the hash of each accepted block
+    // map<block_id, block> stores all received blocks with all their signatures
+    // Readers take the pointer under mutex_cons_ and copy the block after releasing it, so a block that is
+    // shared with a reader is copied before a signature is added (copy on write)
+    std::unordered_map<std::string, std::shared_ptr<blockchain::Block>> blocks_;
+    std::unordered_map<std::string, std::vector<blockchain::BlockSignature>> pending_sigs_;  // map<block_id, sigs> signatures of votes for blocks not received yet
+    std::vector<std::string> accepted_blocks_;                      // stores the hash of each accepted block in delivery order
+    std::atomic<size_t> accepted_count_{0};                         // size of accepted_blocks_, read without mutex_cons_
+    uint64_t delivered_height_ = 0;                                 // number of accepted blocks
+    DeliveryHandler delivery_handler_;                              // takes the accepted blocks instead of accepted_blocks_ if set
+    std::vector<DeliveredBlock> deliveries_;                        // accepted blocks waiting for the delivery handler
+    AbandonHandler abandon_handler_;                                // takes the blocks of abandoned instances if set
+    std::vector<std::pair<InstanceID, std::shared_ptr<blockchain::Block>>> abandoned_;  // abandoned blocks waiting for the abandon handler
+    std::map<InstanceID, std::set<std::string>> seen_;              // map<instance, block_ids> of undelivered blocks & pending signatures
+    std::deque<std::pair<uint64_t, std::string>> delivered_log_;    // (delivery height, block_id) of delivered blocks held in full
+    std::deque<CompactedBlock> compacted_;                          // delivered blocks compacted to digest & certificate, oldest first
 };
 
 class LeaderNode : public Node {
@@ -261,14 +585,14 @@ class LeaderNode : public Node {
     bool isLeader() { return true; }
 
    public:
-    // @ override
-    void RunProtocol(bool broadcast);
-
     /**
      * @brief propose a new block to all the existing nodes.
      *
+     * Opens a new broadcast instance with the next sequence number, blocks while
+     * pipeline depth instances of this leader are still undelivered.
+     *
      * @param NONE
-     * @return
+     * @return 1 if the block was broadcast, 0 if the node is not running or stopped while the pipeline was full
      */
     int Propose(blockchain::Block& bk);
 };
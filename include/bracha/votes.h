@@ -0,0 +1,76 @@
+#ifndef COSICOIN_INCLUDE_VOTES_H
+#define COSICOIN_INCLUDE_VOTES_H
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Maximum number of validators that can vote in one instance
+#define MAX_VALIDATORS_ 256
+
+namespace bracha {
+
+// Voting phases of the protocol
+enum class Phase { ECHO = 0,
+                   READY = 1 };
+
+// One bit per validator id
+typedef std::bitset<MAX_VALIDATORS_> VoteSet;
+
+/*
+ * Keeps the ECHO and READY votes of one broadcast instance
+ * Every validator is counted at most once per block digest and phase
+ */
+class VoteTracker {
+   public:
+    /*
+     * Records the vote of `validator_id` for `digest` in the given phase
+     * Returns false if the vote was already counted or the id is out of range
+     */
+    bool add(const std::string& digest, Phase phase, uint16_t validator_id);
+
+    /*
+     * Returns the number of distinct validators that voted for `digest` in the given phase
+     */
+    size_t count(const std::string& digest, Phase phase) const;
+
+    /*
+     * Returns the first digest that has at least `threshold` votes in the given phase
+     * Returns an empty string if no digest reached the threshold
+     */
+    std::string reached(Phase phase, size_t threshold) const;
+
+    /*
+     * Returns the validators that voted for `digest` in the given phase
+     */
+    VoteSet voters(const std::string& digest, Phase phase) const;
+
+    /*
+     * Returns a short overview of the votes, e.g. "abcdef0123: echo 3, ready 2; "
+     */
+    std::string to_string() const;
+
+    /*
+     * Releases all votes
+     */
+    void clear();
+
+    bool empty() const { return entries_.empty(); };
+
+   private:
+    struct Entry {
+        std::string digest;
+        VoteSet votes[2];  // indexed by Phase
+    };
+
+    // An instance only sees a few different digests, a linear scan is cheaper than hashing the digest
+    std::vector<Entry> entries_;
+
+    Entry* find(const std::string& digest);
+    const Entry* find(const std::string& digest) const;
+};
+
+}  // namespace bracha
+
+#endif
@@ -3,26 +3,49 @@
 
 #include <chat.grpc.pb.h>
 #include <grpc/support/log.h>
+#include <grpcpp/alarm.h>
 #include <grpcpp/grpcpp.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <random>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "blockchain/message.h"
 #include "blockchain/transaction.h"
 #include "blockchain/utxo.h"
+#include "comms/connection.h"
+#include "comms/encoded.h"
+#include "comms/queue.h"
 #include "config/settings.h"
 
+// Seconds to wait for the answer on a block fetch request
+#define FETCH_TIMEOUT_S_ 2
+// Max number of consensus messages framed into one write of a stream
+#define STREAM_BATCH_ 64
+// Milliseconds to wait before a broken stream is opened again
+#define STREAM_RETRY_MS_ 200
+// Full name of the Stream RPC, called through the generic stub with pre-encoded batches
+#define STREAM_METHOD_ "/chat.Chat/Stream"
+// Max number of queued consensus messages per peer, a peer that falls further behind misses messages
+#define MAX_PEER_QUEUE_ 8192
+#define PEER_QUEUE_WAIT_MS_ 1000  // time a broadcast waits for a full peer queue before the peer falls out of sync
+// A peer that fell out of sync holds up the broadcasts again once its queue drained below this depth
+#define PEER_CATCH_UP_DEPTH_ (MAX_PEER_QUEUE_ / 4)
+
 using grpc::Channel;
-using grpc::ClientAsyncResponseReader;
 using grpc::ClientContext;
 using grpc::CompletionQueue;
 using grpc::Status;
@@ -33,37 +56,52 @@ namespace comms {
 
 class WalletClientImpl {
    public:
-    WalletClientImpl(){};
+    WalletClientImpl() : connections_(std::make_shared<ConnectionManager>()){};
     WalletClientImpl(config::Settings settings);
-    // Copy constructor
-    WalletClientImpl(const WalletClientImpl &wallet_client) : leader_(wallet_client.leader_){};
+    // Copy constructor, the copy shares the channel
+    WalletClientImpl(const WalletClientImpl &wallet_client) : leader_(wallet_client.leader_), connections_(wallet_client.connections_){};
     // Move constructor
-    WalletClientImpl(WalletClientImpl &&wallet_client) noexcept : leader_(std::move(wallet_client.leader_)){};
+    WalletClientImpl(WalletClientImpl &&wallet_client) noexcept : leader_(std::move(wallet_client.leader_)), connections_(std::move(wallet_client.connections_)){};
 
     /*
      * Sends the specified transaction to the leader validator
+     * Returns 0 if the leader did not accept it, e.g. RESOURCE_EXHAUSTED under load; the wallet should back off & retry
      */
     int SendToLeader(const blockchain::Transaction transaction);
 
+    /*
+     * Sends the transactions to the leader validator in one call
+     * Fills `codes` with the outcome of every transaction, in order; `codes` stays empty if the call failed
+     * Returns the number of accepted transactions
+     */
+    int SendBatchToLeader(const std::vector<blockchain::Transaction> &transactions, std::vector<chat::TxCode> &codes);
+
     /*
      * Sends a sync request to the leader
      * Fills utxolist with the received answer
      */
     int SendSyncRequest(const uint32_t wallet_id, blockchain::UTXOlist &utxolist);
 
+    /*
+     * Returns the state & RPC counters of the channel to the leader
+     */
+    std::vector<ChannelMetrics> getChannelMetrics() { return connections_->getMetrics(); };
+
    private:
     // Address of the leader
     std::string leader_;
+    // Long-lived channel to the leader
+    std::shared_ptr<ConnectionManager> connections_;
 };
 
 class ValidatorClientImpl {
    public:
-    ValidatorClientImpl(){};
+    ValidatorClientImpl() : connections_(std::make_shared<ConnectionManager>()){};
     ValidatorClientImpl(config::Settings settings);
-    // Copy constructor
-    ValidatorClientImpl(const ValidatorClientImpl &validator_client) : servers_(validator_client.servers_), leader_(validator_client.leader_) { startThreads_(); };
+    // Copy constructor, the copy shares the channels
+    ValidatorClientImpl(const ValidatorClientImpl &validator_client) : servers_(validator_client.servers_), validators_(validator_client.validators_), leader_(validator_client.leader_), connections_(validator_client.connections_), send_window_(validator_client.send_window_) { startThreads_(); };
     // Move constructor
-    ValidatorClientImpl(ValidatorClientImpl &&validator_client) noexcept : servers_(std::move(validator_client.servers_)), leader_(std::move(validator_client.leader_)) { startThreads_(); };
+    ValidatorClientImpl(ValidatorClientImpl &&validator_client) noexcept : servers_(std::move(validator_client.servers_)), validators_(std::move(validator_client.validators_)), leader_(std::move(validator_client.leader_)), connections_(validator_client.connections_), send_window_(validator_client.send_window_) { startThreads_(); };
 
     ~ValidatorClientImpl();
 
@@ -82,33 +120,117 @@ class ValidatorClientImpl {
      */
     int SendToLeader(const blockchain::Message message);
 
+    /*
+     * Sends the specified message to the validator with the given id
+     * Returns 0 if the validator is unknown
+     */
+    int Send(const blockchain::Message message, uint16_t validator_id);
+
+    /*
+     * Requests the block with the given hash from the validator with the given id
+     * Blocks until the validator answered or the request timed out
+     * Returns true if the validator knew the block, the block is stored in `block`
+     */
+    bool FetchBlock(const std::string &block_hash, uint16_t validator_id, blockchain::Block &block);
+
+    /*
+     * Returns the state & RPC counters of the channel to every validator that was contacted
+     */
+    std::vector<ChannelMetrics> getChannelMetrics() { return connections_->getMetrics(); };
+
+    /*
+     * Returns the number of queued & unacknowledged messages per validator address
+     */
+    std::map<std::string, size_t> getQueueDepths();
+
+    /*
+     * Returns the number of messages dropped per validator address because its queue stayed full
+     * A validator with dropped messages can't verify the later messages of this node, it has to catch up
+     */
+    std::map<std::string, uint64_t> getDroppedMessages();
+
    private:
+    // Tags of the events on the completion queue of a peer
+    enum Event { WAKE = 1,   // alarm set by Wake_()
+                 STARTED,    // stream is established
+                 WRITTEN,    // batch is handed to the transport
+                 ACKED,      // ack of the oldest unacknowledged batch arrived
+                 FINISHED,   // final status of a broken stream arrived
+                 RETRY };    // stream can be opened again
+
+    // Sender state of one peer, owned by its sender thread
+    struct Peer {
+        std::string address;
+        MPSCQueue<EncodedMessage> queue{MAX_PEER_QUEUE_};  // encoded messages, shared by all peers of a broadcast
+        std::atomic<size_t> depth{0};                      // queued & unacknowledged messages
+        std::atomic<uint64_t> dropped{0};                  // messages dropped because the queue was full
+        std::atomic<bool> lagging{false};                  // messages were dropped & the peer didn't catch up yet
+        uint64_t next_seq = 1;                             // seq of the next message of this session
+        CompletionQueue cq;                     // completions of the stream to this peer
+        grpc::Alarm alarm;                      // posted on the cq to wake up the sender thread
+        grpc::Alarm retry_alarm;                // posted on the cq once a broken stream may be opened again
+        std::atomic<bool> wake_pending{false};
+        std::mutex wake_mtx;
+        bool closed = false;  // cq is shutting down, guarded by wake_mtx
+
+        // Long-lived stream to the peer, one write & one read are outstanding at most
+        std::unique_ptr<ClientContext> context;
+        std::unique_ptr<grpc::GenericClientAsyncReaderWriter> stream;  // writes chat::SendBatch, reads chat::Ack
+        grpc::ByteBuffer ack;
+        Status status;
+        bool open = false;     // stream is established & not broken
+        bool writing = false;  // a write is outstanding
+        bool reading = false;  // a read is outstanding
+        bool failed = false;   // stream broke, it's finished once no write & read is outstanding
+        bool backoff = false;  // waiting for the retry alarm
+        std::deque<std::pair<uint64_t, EncodedMessage>> unacked;  // (seq, message) in the send window, resent on a new stream until the peer acks them
+        size_t written = 0;                                       // number of unacked messages written on the current stream
+        std::queue<size_t> batches;      // number of messages of every unacknowledged write
+    };
+
     // Vector to keep server addresses
     std::vector<std::string> servers_;
+    // Address of each validator by id
+    std::map<uint32_t, std::string> validators_;
     // Address of the leader
     std::string leader_;
+    // One long-lived channel per validator, shared with copies of this client
+    std::shared_ptr<ConnectionManager> connections_;
 
-    // Queues of messages that need to be send to the servers
-    // One queue per server
-    std::map<std::string, std::shared_ptr<std::queue<blockchain::Message>>> message_queues_;
-
-    // Condition variable to notify threads a new message is added to the queues
-    std::condition_variable mq_cv_;
+    // Max number of unacknowledged messages per peer
+    uint32_t send_window_ = 8;
+    // Random id of this client, lets the servers order pipelined messages per session
+    uint64_t session_ = 0;
 
-    // Mutex for the queues
-    std::mutex mq_mtx_;
+    // Queues of messages that need to be send to the servers
+    // One peer per server
+    std::map<std::string, std::shared_ptr<Peer>> peers_;
 
     // Thread pool for sending threads
     std::vector<std::thread> thread_pool_;
 
-    bool stop_threads_;
-    std::mutex st_mtx_;
+    // Cleared on destruction, stops the sender threads & releases broadcasts waiting for a full queue
+    std::atomic<bool> running_{true};
+
+    // Run one thread for one server, streams up to send_window_ unacknowledged messages to it
+    void RunThread_(std::shared_ptr<Peer> peer);
+
+    // Queue an encoded message for a peer & wake up its sender thread
+    void Enqueue_(Peer &peer, const EncodedMessage &message);
+
+    // Wake up the sender thread of a peer
+    void Wake_(Peer &peer);
+
+    // Open a new stream to a peer, the messages that weren't acked yet are written again
+    void OpenStream_(Peer &peer);
 
-    // Run one thread for one server and give it it's queue
-    void RunThread_(const std::string server_address, std::shared_ptr<std::queue<blockchain::Message>> mq);
+    // Write the next batch of the send window to the stream of a peer
+    void WriteBatch_(Peer &peer);
 
-    // Send message to a specific server
-    int SendMessage_(const blockchain::Message message, const std::string server_address);
+    // Mark the stream of a peer as broken & cancel its outstanding operations
+    void FailStream_(Peer &peer);
+
+    static void *tag_(Event event) { return reinterpret_cast<void *>(static_cast<intptr_t>(event)); };
 
     void startThreads_();
 };
@@ -117,16 +239,27 @@ class ValidatorClientImpl {
 class ChatClient {
    public:
     explicit ChatClient(std::shared_ptr<Channel> channel) : stub_(Chat::NewStub(channel)){};
+    // Uses the cached channel to `address`, results are counted in the channel metrics
+    ChatClient(ConnectionManager *connections, const std::string &address) : stub_(connections->getStub(address)), connections_(connections), address_(address){};
 
     void Talk(const blockchain::Message &message);
 
     void Sync(const uint32_t wallet_id, blockchain::UTXOlist *utxolist);
 
-    void NewTx(const blockchain::Transaction &transaction);
+    // Returns false if the call failed or the leader turned the transaction away
+    bool NewTx(const blockchain::Transaction &transaction);
+
+    // Returns false if the call failed, `codes` has one code per transaction otherwise
+    bool NewTxBatch(const std::vector<blockchain::Transaction> &transactions, std::vector<chat::TxCode> *codes);
+
+    bool FetchBlock(const std::string &block_hash, blockchain::Block *block);
 
    private:
-    std::unique_ptr<Chat::Stub> stub_;
-    CompletionQueue cq_;
+    void record_(const Status &status);
+
+    std::shared_ptr<Chat::Stub> stub_;
+    ConnectionManager *connections_ = nullptr;
+    std::string address_;
 };
 }  // namespace comms
 
@@ -0,0 +1,95 @@
+#ifndef COSICOIN_COMMS_CONNECTION_H
+#define COSICOIN_COMMS_CONNECTION_H
+
+#include <chat.grpc.pb.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config/settings.h"
+
+namespace comms {
+
+// Counters of the channel to one peer
+struct ChannelMetrics {
+    std::string address;
+    grpc_connectivity_state state = GRPC_CHANNEL_IDLE;
+    uint64_t rpcs = 0;      // finished RPCs
+    uint64_t failures = 0;  // finished RPCs that did not return OK
+};
+
+/*
+ * Keeps one long-lived channel & stub per peer address
+ *
+ * Channels are created on first use with the keepalive & reconnect backoff settings,
+ * gRPC reconnects them on its own after a failure. Stubs are thread safe and shared by all callers.
+ */
+class ConnectionManager {
+   public:
+    ConnectionManager(){};
+    explicit ConnectionManager(config::Settings settings);
+
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    /*
+     * Returns the stub of the channel to `address`, creates the channel if it does not exist yet
+     */
+    std::shared_ptr<chat::Chat::Stub> getStub(const std::string& address);
+
+    /*
+     * Returns the generic stub of the channel to `address`, for calls that write pre-encoded ByteBuffers
+     */
+    std::shared_ptr<grpc::GenericStub> getGenericStub(const std::string& address);
+
+    /*
+     * Counts a finished RPC to `address`
+     */
+    void recordResult(const std::string& address, const grpc::Status& status);
+
+    /*
+     * Returns the connectivity state of the channel to `address` without connecting it
+     * Returns GRPC_CHANNEL_SHUTDOWN if there is no channel to `address`
+     */
+    grpc_connectivity_state getState(const std::string& address);
+
+    /*
+     * Returns the counters & state of every channel
+     */
+    std::vector<ChannelMetrics> getMetrics();
+
+    // Number of open channels
+    size_t size();
+
+   private:
+    struct Connection {
+        std::shared_ptr<grpc::Channel> channel;
+        std::shared_ptr<chat::Chat::Stub> stub;
+        std::shared_ptr<grpc::GenericStub> generic_stub;
+        uint64_t rpcs = 0;
+        uint64_t failures = 0;
+    };
+
+    grpc::ChannelArguments channelArguments_() const;
+
+    // Returns the connection to `address`, creates it if it does not exist yet, mutex_ has to be held
+    Connection& connection_(const std::string& address);
+
+    std::map<std::string, Connection> connections_;
+    std::mutex mutex_;
+
+    int keepalive_time_ms_ = 10000;
+    int keepalive_timeout_ms_ = 5000;
+    int reconnect_backoff_min_ms_ = 100;
+    int reconnect_backoff_max_ms_ = 5000;
+};
+
+}  // namespace comms
+
+#endif
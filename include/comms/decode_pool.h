@@ -0,0 +1,58 @@
+#ifndef COSICOIN_COMMS_DECODE_POOL_H
+#define COSICOIN_COMMS_DECODE_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "comms/queue.h"
+
+// Max number of queued tasks per decode thread
+#define DECODE_LANE_CAPACITY_ 1024
+
+namespace comms {
+
+/*
+ * Runs decode work of the gRPC server off the completion queue threads
+ *
+ * Every thread owns one lane (a MPSC ring), a task is queued on lane `key % lanes`.
+ * Tasks with the same key (e.g. the same sender) therefore run in submission order,
+ * which keeps the signing key chain of a sender in order.
+ */
+class DecodePool {
+   public:
+    typedef std::function<void()> Task;
+
+    explicit DecodePool(uint32_t num_threads);
+    ~DecodePool();
+
+    DecodePool(const DecodePool&) = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+
+    /*
+     * Queues `task` on the lane of `key`
+     * Blocks while the lane is full, runs the task in the calling thread once the pool stopped
+     */
+    void Submit(uint64_t key, Task task);
+
+    /*
+     * Runs the queued tasks & joins the threads, no task is accepted afterwards
+     */
+    void Stop();
+
+    uint32_t getNumberOfThreads() const { return lanes_.size(); };
+
+   private:
+    void RunLane_(uint32_t lane);
+
+    std::vector<std::unique_ptr<MPSCQueue<Task>>> lanes_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{true};
+};
+
+}  // namespace comms
+
+#endif
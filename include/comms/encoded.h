@@ -0,0 +1,41 @@
+#ifndef COSICOIN_COMMS_ENCODED_H
+#define COSICOIN_COMMS_ENCODED_H
+
+#include <chat.pb.h>
+#include <grpcpp/support/slice.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "blockchain/message.h"
+
+namespace comms {
+
+/*
+ * A consensus message serialized once, ready to be written to any number of peers
+ *
+ * The bytes live in a refcounted slice, copies & frames built from it share them.
+ * A broadcast costs one serialization, every peer only adds a few framing bytes.
+ */
+class EncodedMessage {
+   public:
+    EncodedMessage(){};
+    explicit EncodedMessage(const blockchain::Message& message);
+    explicit EncodedMessage(const chat::Message& message);
+
+    // Size of the serialized chat::Message
+    size_t size() const { return slice_.size(); };
+
+    /*
+     * Appends the message as one `sends` entry of a chat::SendBatch to `slices`
+     * Concatenated entries form a valid SendBatch, the message bytes are shared & not copied
+     */
+    void appendSend(uint64_t session, uint64_t seq, std::vector<grpc::Slice>& slices) const;
+
+   private:
+    grpc::Slice slice_;
+};
+
+}  // namespace comms
+
+#endif
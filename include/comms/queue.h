@@ -0,0 +1,280 @@
+#ifndef COSICOIN_COMMS_QUEUE_H
+#define COSICOIN_COMMS_QUEUE_H
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace comms {
+
+/*
+ * Bounded lock-free multi producer, single consumer FIFO ring with its own wakeup
+ *
+ * Producers (the gRPC handlers) move items in, one consumer thread drains them in batches.
+ * Every slot carries a sequence number (Vyukov's bounded queue): producers claim a position with a CAS
+ * and publish the slot with a release store, the consumer never takes a lock.
+ * The consumer sleeps on an eventfd that only this queue signals, so it is never woken by traffic of other queues.
+ * The eventfd counter keeps a wakeup that arrives before the consumer sleeps, no notification is lost.
+ * Producers that have to wait for a free slot sleep on a condition variable, it is only touched while the ring is full.
+ */
+template <typename T>
+class MPSCQueue {
+   public:
+    // The capacity is rounded up to a power of two
+    explicit MPSCQueue(size_t capacity = 4096) {
+        capacity_ = 2;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        cells_.reset(new Cell[capacity_]);
+        for (size_t i = 0; i < capacity_; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0) {
+            throw std::runtime_error("MPSCQueue: cannot create eventfd");
+        }
+    }
+
+    ~MPSCQueue() {
+        close(event_fd_);
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    /*
+     * Moves an item in and wakes up the consumer
+     * Returns false if the ring is full, the item is left untouched
+     */
+    bool push(T&& item) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        wake();
+        return true;
+    }
+
+    bool push(const T& item) {
+        T copy(item);
+        return push(std::move(copy));
+    }
+
+    /*
+     * Moves an item in, blocks while the ring is full & `running` is set
+     * Returns false if `running` was cleared before a slot got free, the item is left untouched
+     * Whoever clears `running` has to call wakeProducers()
+     */
+    bool pushWait(T&& item, const std::atomic<bool>& running) {
+        while (!push(std::move(item))) {
+            std::unique_lock<std::mutex> lock(space_mutex_);
+            space_waiters_++;
+            space_cv_.wait(lock, [&]() { return !full_() || !running; });
+            space_waiters_--;
+            if (!running) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Like pushWait(), but gives up once the ring stayed full for `timeout`
+     * Returns false on timeout or if `running` was cleared, the item is left untouched
+     */
+    bool pushWait(T&& item, const std::atomic<bool>& running, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!push(std::move(item))) {
+            std::unique_lock<std::mutex> lock(space_mutex_);
+            space_waiters_++;
+            bool woken = space_cv_.wait_until(lock, deadline, [&]() { return !full_() || !running; });
+            space_waiters_--;
+            if (!woken || !running) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Moves the first items of `items` in with one claim & one wakeup, as many as fit
+     * Returns the number of moved items, the items behind them are left untouched
+     */
+    size_t pushAll(std::vector<T>& items) {
+        if (items.empty()) {
+            return 0;
+        }
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t count;
+        while (true) {
+            size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff < 0) {
+                return 0;
+            }
+            if (diff > 0) {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            // The consumer frees cells in order, so the free cells behind pos are contiguous
+            size_t lo = 1;
+            size_t hi = std::min(items.size(), capacity_);
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo + 1) / 2;
+                if (cells_[(pos + mid - 1) & mask_].sequence.load(std::memory_order_acquire) == pos + mid - 1) {
+                    lo = mid;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            count = lo;
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            Cell* cell = &cells_[(pos + i) & mask_];
+            cell->data = std::move(items[i]);
+            cell->sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        wake();
+        return count;
+    }
+
+    /*
+     * Moves up to `max_items` queued items to the end of `out` in FIFO order
+     * Only the consumer thread may call this
+     * Returns true if at least one item was moved
+     */
+    bool popAll(std::vector<T>& out, size_t max_items = std::numeric_limits<size_t>::max()) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while (count < max_items) {
+            Cell* cell = &cells_[pos & mask_];
+            if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+                // Empty, or the next producer did not publish yet; its push wakes the consumer again
+                break;
+            }
+            out.push_back(std::move(cell->data));
+            cell->data = T();
+            cell->sequence.store(pos + capacity_, std::memory_order_release);
+            pos++;
+            count++;
+        }
+        // Pairs with the waiter count of pushWait(), either the producer sees the free slots or it is woken up
+        dequeue_pos_.store(pos, std::memory_order_seq_cst);
+        if (count > 0 && space_waiters_.load(std::memory_order_seq_cst) > 0) {
+            wakeProducers();
+        }
+        return count > 0;
+    }
+
+    /*
+     * Returns true if the next item is not published yet
+     */
+    bool empty() const {
+        size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /*
+     * Number of claimed slots, including pushes that are still in progress
+     * Gauge for back-pressure, can be stale by the time it returns
+     */
+    size_t size() const {
+        size_t head = dequeue_pos_.load(std::memory_order_acquire);
+        size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    /*
+     * Blocks the consumer until an item is queued, wake() is called or `timeout_ms` passed (-1 waits forever)
+     * Returns true if the queue is not empty
+     */
+    bool wait(int timeout_ms = -1) {
+        if (!empty()) {
+            return true;
+        }
+        struct pollfd pfd = {event_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            // Resets the counter, the next wait sleeps again once the queue is drained
+            uint64_t count;
+            ssize_t ret = read(event_fd_, &count, sizeof(count));
+            (void)ret;
+        }
+        return !empty();
+    }
+
+    /*
+     * Wakes up the consumer, used by push() and to stop a waiting consumer
+     */
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ret = write(event_fd_, &one, sizeof(one));
+        (void)ret;
+    }
+
+    /*
+     * Wakes up the producers blocked in pushWait(), used by popAll() and to stop them
+     */
+    void wakeProducers() {
+        std::lock_guard<std::mutex> lock(space_mutex_);
+        space_cv_.notify_all();
+    }
+
+   private:
+    // Sequentially consistent with the waiter count, see popAll()
+    bool full_() const {
+        return enqueue_pos_.load(std::memory_order_seq_cst) - dequeue_pos_.load(std::memory_order_seq_cst) >= capacity_;
+    }
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t capacity_;
+    size_t mask_;
+    // Producer & consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    int event_fd_;
+    std::mutex space_mutex_;
+    std::condition_variable space_cv_;
+    std::atomic<uint32_t> space_waiters_{0};
+};
+
+}  // namespace comms
+
+#endif
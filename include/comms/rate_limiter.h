@@ -0,0 +1,61 @@
+#ifndef COSICOIN_COMMS_RATE_LIMITER_H
+#define COSICOIN_COMMS_RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Max number of tracked senders, idle senders are forgotten beyond that
+#define RATE_LIMIT_SENDERS_ 65536
+
+namespace comms {
+
+/*
+ * Token bucket per sender
+ *
+ * Every sender may send `burst` requests at once and `rate` requests per second on average.
+ * A rate of 0 disables the limit.
+ */
+class RateLimiter {
+   public:
+    explicit RateLimiter(uint32_t rate = 0, uint32_t burst = 0) : rate_(rate), burst_(burst){};
+
+    /*
+     * Takes up to `count` tokens of `sender`
+     * Returns the number of tokens taken, requests beyond that should be rejected
+     */
+    size_t acquire(uint64_t sender, size_t count = 1) { return acquire(sender, count, std::chrono::steady_clock::now()); };
+    size_t acquire(uint64_t sender, size_t count, std::chrono::steady_clock::time_point now);
+
+    /*
+     * Gives `count` tokens taken by acquire() back to `sender`, for requests that were rejected for another reason
+     * The bucket never grows beyond the burst size
+     */
+    void release(uint64_t sender, size_t count);
+
+    // Number of requests that were rejected so far
+    uint64_t getLimited() const { return limited_; };
+
+    bool enabled() const { return rate_ > 0; };
+
+   private:
+    struct Bucket {
+        double tokens;
+        std::chrono::steady_clock::time_point last;  // last refill
+    };
+
+    // Drops senders whose bucket is full again, they lose nothing by being forgotten
+    void prune_(std::chrono::steady_clock::time_point now);
+
+    uint32_t rate_;
+    uint32_t burst_;
+    std::unordered_map<uint64_t, Bucket> buckets_;
+    std::mutex mutex_;
+    std::atomic<uint64_t> limited_{0};
+};
+
+}  // namespace comms
+
+#endif
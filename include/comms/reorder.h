@@ -0,0 +1,60 @@
+#ifndef COSICOIN_COMMS_REORDER_H
+#define COSICOIN_COMMS_REORDER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "blockchain/message.h"
+
+// Max number of messages held back for one session before a missing message is skipped
+#define REORDER_LIMIT_ 4096
+
+namespace comms {
+
+/*
+ * Restores the send order of pipelined messages
+ *
+ * A client with several calls in flight can have them arrive out of order,
+ * but the one-time signing keys of a validator have to be verified in the order they were used.
+ * Every session (sender, random session id) numbers its messages from 1,
+ * messages are released once all messages before them were released.
+ * A sender runs one session at a time: a new session supersedes the previous one & its held back messages are discarded.
+ * The first message of an unknown session starts it, e.g. after this validator restarted mid-session.
+ */
+class ReorderBuffer {
+   public:
+    /*
+     * Adds a message & hands every message that is now in order to `deliver`
+     * Messages with seq 0 are not ordered and handed over right away, duplicates are dropped
+     * A message `deliver` refuses (e.g. a full queue) has to be left untouched, it is held back with everything behind it & its seq is not used up.
+     * Every later add of the session, a resent duplicate included, tries to hand it over again.
+     * Returns false if a message that is in order could not be handed over
+     */
+    bool add(uint64_t sender, uint64_t session, uint64_t seq, blockchain::Message&& message, const std::function<bool(blockchain::Message&&)>& deliver);
+
+    /*
+     * Adds a message & appends every message that is now in order to `ready`
+     */
+    void add(uint64_t sender, uint64_t session, uint64_t seq, blockchain::Message&& message, std::vector<blockchain::Message>& ready);
+
+    // Number of messages held back over all sessions
+    size_t pending();
+
+   private:
+    struct Session {
+        uint64_t id = 0;                                  // random session id of the sender
+        uint64_t next = 1;                                // seq of the next message to hand over
+        std::map<uint64_t, blockchain::Message> waiting;  // map<seq, message> of messages that arrived early or were refused
+    };
+
+    std::map<uint64_t, Session> sessions_;  // map<sender, current session>
+    std::mutex mutex_;
+};
+
+}  // namespace comms
+
+#endif
@@ -6,8 +6,11 @@
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -16,32 +19,54 @@
 #include <unordered_map>
 #include <vector>
 
+#include "blockchain/block.h"
 #include "blockchain/message.h"
 #include "blockchain/transaction.h"
 #include "blockchain/utxo.h"
+#include "comms/decode_pool.h"
+#include "comms/queue.h"
+#include "comms/rate_limiter.h"
+#include "comms/reorder.h"
+#include "config/settings.h"
 
 using chat::Chat;
 using grpc::CompletionQueue;
 using grpc::Server;
+using grpc::ServerAsyncReaderWriter;
 using grpc::ServerAsyncResponseWriter;
 using grpc::ServerBuilder;
 using grpc::ServerCompletionQueue;
 using grpc::ServerContext;
 using grpc::Status;
 
+#define MQ_CAPACITY_ 8192   // max number of queued consensus messages
+#define TXQ_CAPACITY_ 8192  // default max number of queued transactions
+#define SERVER_THREADS_ 2   // default number of completion queues & decode threads
+#define SHUTDOWN_GRACE_MS_ 500  // time calls get to finish on shutdown, open streams of peers are cancelled afterwards
+
 namespace comms {
 
+// Looks up the block with the given hash, returns false if the block is not known
+typedef std::function<bool(const std::string&, blockchain::Block&)> BlockProvider;
+
+// Returns true if the block with the given hash is known, its body is not decoded again
+typedef std::function<bool(const std::string&)> KnownBlockFilter;
+
 class ChatServiceImpl {
    public:
-    // ChatServiceImpl(){};
-    // ChatServiceImpl(std::condition_variable* cv) : cv_(cv){};
+    ChatServiceImpl() : txq_(TXQ_CAPACITY_){};
+    explicit ChatServiceImpl(config::Settings settings)
+        : num_threads_(std::max<uint32_t>(1, settings.getServerThreads())),
+          txq_(std::max<uint32_t>(1, settings.getTxQueueCapacity())),
+          tx_limiter_(settings.getTxRateLimit(), settings.getTxBurst()){};
     ~ChatServiceImpl();
 
     /**
      * @brief Runs the server on the specified port.
      *
      * This function starts the server and listens for incoming connections on the specified port.
-     * This function needs to be run in a separate thread, it does not return
+     * Every completion queue is polled by its own thread, the calling thread polls the first one.
+     * This function needs to be run in a separate thread, it returns once the server is destroyed
      *
      * @param port The port number on which the server should listen.
      */
@@ -69,6 +94,30 @@ class ChatServiceImpl {
      */
     bool newRequests();
 
+    /*
+     * Number of queued consensus messages & transactions, gauges for back-pressure
+     * Talk & NewTx calls are answered with RESOURCE_EXHAUSTED while their queue is full, a Stream is closed without acking the batch
+     */
+    size_t getConsensusQueueSize() const { return mq_.size(); };
+    size_t getTxQueueSize() const { return txq_.size(); };
+    size_t getTxQueueCapacity() const { return txq_.capacity(); };
+
+    /*
+     * Number of transactions rejected because the transaction queue was full, or because their client exceeded its rate limit
+     */
+    uint64_t getTxRejectedFull() const { return tx_rejected_full_; };
+    uint64_t getTxRateLimited() const { return tx_limiter_.getLimited(); };
+
+    /*
+     * Number of consensus messages held back because the consensus queue was full, they are handed over on a retry
+     */
+    uint64_t getConsensusRefused() const { return consensus_refused_; };
+
+    /*
+     * Number of consensus messages that arrived ahead of an earlier message of the same sender
+     */
+    size_t getReorderPending() { return reorder_.pending(); };
+
     /*
      * Appends all new transactions from wallets in `tx_list`
      * Deletes these transactions from internal FIFO queue
@@ -87,24 +136,61 @@ class ChatServiceImpl {
     void clearUTXOlists();
 
     /*
-     * Returns a pointer to a condition variable that gets notified when a new message or transaction is received
+     * Sets the function that answers block fetch requests of other validators
+     * Pass nullptr to stop answering, the call waits until running lookups are finished
+     */
+    void setBlockProvider(BlockProvider provider);
+
+    /*
+     * Sets the function that tells the decode threads which blocks are known already
+     * Consensus messages carrying a known block are decoded as a vote of the block's signer, without its transactions
+     * Pass nullptr to decode every block, the call waits until running lookups are finished
      */
-    std::condition_variable* getConditionVariable() { return &cv_; };
+    void setKnownBlockFilter(KnownBlockFilter filter);
+
+    /*
+     * Blocks until a consensus message is received, wakeConsensus() is called or `timeout_ms` passed (-1 waits forever)
+     * Only Talk & Stream messages wake up this call, returns true if there are new consensus messages
+     */
+    bool waitConsensusMessages(int timeout_ms = -1) { return mq_.wait(timeout_ms); };
+
+    /*
+     * Blocks until a transaction is received, wakeRequests() is called or `timeout_ms` passed (-1 waits forever)
+     * Only NewTx & NewTxBatch requests wake up this call, returns true if there are new transactions
+     */
+    bool waitRequests(int timeout_ms = -1) { return txq_.wait(timeout_ms); };
+
+    /*
+     * Wakes up the thread waiting for consensus messages, e.g. to let it stop
+     */
+    void wakeConsensus() { mq_.wake(); };
+
+    /*
+     * Wakes up the thread waiting for transactions, e.g. to let it stop
+     */
+    void wakeRequests() { txq_.wake(); };
 
    public:
     class CallData {
        public:
         CallData(Chat::AsyncService* service, ServerCompletionQueue* cq)
             : cd_service_(service), cd_cq_(cq), status_(CREATE){};
+        virtual ~CallData(){};
 
+        // Advances the state machine, called by the completion queue thread for every event of this call
         virtual void Proceed() = 0;
 
+        // Called instead of Proceed() if the event failed (server shutdown, client went away or closed its stream)
+        virtual void Abort() { delete this; };
+
        protected:
         Chat::AsyncService* cd_service_;
         ServerCompletionQueue* cd_cq_;
         ServerContext ctx_;
         enum CallStatus { CREATE,
                           START_PROCESS,
+                          READ,
+                          WRITE,
                           FINISH };
         CallStatus status_;  // The current serving state.
     };
@@ -112,41 +198,109 @@ class ChatServiceImpl {
     class CallDataTalk : public CallData {
        public:
         // One Calldata object handling each request thread
-        CallDataTalk(Chat::AsyncService* service, ServerCompletionQueue* cq, std::queue<blockchain::Message>* mq,
-                     std::mutex* io_mutex, std::mutex* mq_mutex, std::condition_variable* cv);
+        CallDataTalk(Chat::AsyncService* service, ServerCompletionQueue* cq, MPSCQueue<blockchain::Message>* mq,
+                     DecodePool* decoder, ReorderBuffer* reorder, KnownBlockFilter* filter, std::mutex* filter_mutex, std::atomic<uint64_t>* refused, std::mutex* io_mutex);
 
         void Proceed() override;
 
        private:
-        std::queue<blockchain::Message>* cd_mq_;
-        std::mutex* cd_mq_mutex_;
+        // Decodes the message & queues it for the consensus thread, runs in the decode pool
+        void Decode();
+
+        MPSCQueue<blockchain::Message>* cd_mq_;
+        DecodePool* cd_decoder_;
+        ReorderBuffer* cd_reorder_;
+        KnownBlockFilter* cd_filter_;
+        std::mutex* cd_filter_mutex_;
+        std::atomic<uint64_t>* cd_refused_;
         std::mutex* cd_io_mutex_;
 
         chat::Send request_;
         chat::Ack reply_;
         ServerAsyncResponseWriter<chat::Ack> responder_;
+    };
+
+    class CallDataStream : public CallData {
+       public:
+        // One Calldata object handling each stream of a peer
+        CallDataStream(Chat::AsyncService* service, ServerCompletionQueue* cq, MPSCQueue<blockchain::Message>* mq,
+                       DecodePool* decoder, ReorderBuffer* reorder, KnownBlockFilter* filter, std::mutex* filter_mutex,
+                       std::atomic<bool>* is_running, std::atomic<uint64_t>* refused, std::mutex* io_mutex);
 
-        std::condition_variable* cd_cv_ = nullptr;
+        void Proceed() override;
+
+        // Ends the stream once the peer closed it, the call is deleted after Finish() completed
+        void Abort() override;
+
+       private:
+        // Decodes a batch, queues its messages for the consensus thread & acks it, runs in the decode pool
+        void Decode();
+
+        MPSCQueue<blockchain::Message>* cd_mq_;
+        DecodePool* cd_decoder_;
+        ReorderBuffer* cd_reorder_;
+        KnownBlockFilter* cd_filter_;
+        std::mutex* cd_filter_mutex_;
+        std::atomic<bool>* cd_is_running_;
+        std::atomic<uint64_t>* cd_refused_;
+        std::mutex* cd_io_mutex_;
+
+        chat::SendBatch batch_;
+        chat::Ack reply_;
+        ServerAsyncReaderWriter<chat::Ack, chat::SendBatch> stream_;
     };
 
     class CallDataNewTx : public CallData {
        public:
         // One Calldata object handling each request thread
-        CallDataNewTx(Chat::AsyncService* service, ServerCompletionQueue* cq, std::queue<blockchain::Transaction>* txq,
-                      std::mutex* io_mutex, std::mutex* txq_mutex, std::condition_variable* cv);
+        CallDataNewTx(Chat::AsyncService* service, ServerCompletionQueue* cq, MPSCQueue<blockchain::Transaction>* txq,
+                      DecodePool* decoder, RateLimiter* limiter, std::atomic<uint64_t>* rejected, std::mutex* io_mutex);
 
         void Proceed() override;
 
        private:
-        std::queue<blockchain::Transaction>* cd_txq_;
+        // Decodes the transaction & queues it for the tx ingest thread, runs in the decode pool
+        void Decode();
+
+        MPSCQueue<blockchain::Transaction>* cd_txq_;
+        DecodePool* cd_decoder_;
+        RateLimiter* cd_limiter_;
+        std::atomic<uint64_t>* cd_rejected_;
         std::mutex* cd_io_mutex_;
-        std::mutex* cd_txq_mutex_;
 
         chat::NewTransaction request_;
         chat::Ack reply_;
         ServerAsyncResponseWriter<chat::Ack> responder_;
+    };
+
+    class CallDataNewTxBatch : public CallData {
+       public:
+        // One Calldata object handling each request thread
+        CallDataNewTxBatch(Chat::AsyncService* service, ServerCompletionQueue* cq, MPSCQueue<blockchain::Transaction>* txq,
+                           DecodePool* decoder, RateLimiter* limiter, std::atomic<uint64_t>* rejected, std::mutex* io_mutex);
+
+        void Proceed() override;
+
+       private:
+        // Decodes the transactions of one sender & queues them for the tx ingest thread in one go, runs in the decode pool
+        void Decode(const std::vector<int>& part);
+
+        // Releases one part, the last one answers with a code per transaction
+        void Done_();
 
-        std::condition_variable* cd_cv_ = nullptr;
+        MPSCQueue<blockchain::Transaction>* cd_txq_;
+        DecodePool* cd_decoder_;
+        RateLimiter* cd_limiter_;
+        std::atomic<uint64_t>* cd_rejected_;
+        std::mutex* cd_io_mutex_;
+
+        chat::TxBatch request_;
+        chat::TxBatchAck reply_;
+        ServerAsyncResponseWriter<chat::TxBatchAck> responder_;
+
+        std::vector<std::vector<int>> parts_;  // index in the batch of the admitted transactions, one part per sender
+        std::atomic<size_t> pending_{0};      // parts not done yet, plus one until every part is submitted
+        std::atomic<size_t> dropped_{0};      // admitted transactions that didn't fit into the ring
     };
 
     class CallDataSync : public CallData {
@@ -167,22 +321,55 @@ class ChatServiceImpl {
         ServerAsyncResponseWriter<chat::SyncReply> responder_;
     };
 
+    class CallDataFetchBlock : public CallData {
+       public:
+        // One Calldata object handling each request thread
+        CallDataFetchBlock(Chat::AsyncService* service, ServerCompletionQueue* cq, BlockProvider* provider,
+                           std::mutex* io_mutex, std::mutex* provider_mutex);
+
+        void Proceed() override;
+
+       private:
+        BlockProvider* cd_provider_;
+        std::mutex* cd_provider_mutex_;
+        std::mutex* cd_io_mutex_;
+
+        chat::BlockReq request_;
+        chat::BlockReply reply_;
+        ServerAsyncResponseWriter<chat::BlockReply> responder_;
+    };
+
    private:
-    void HandleRpcs();
+    // Polls one completion queue until it is shut down
+    void HandleRpcs(ServerCompletionQueue* cq);
+
+    // Decodes a consensus message on a decode thread, skips the body of the blocks `filter` knows
+    static blockchain::Message decodeMessage_(const chat::Message& message, KnownBlockFilter* filter, std::mutex* filter_mutex);
+
+    // Rate limit key of a wallet client: its address without the port, the sender id of a transaction is not authenticated yet
+    static uint64_t limiterKey_(const std::string& peer);
     Chat::AsyncService service_;
     std::unique_ptr<Server> server_;
-    std::unique_ptr<ServerCompletionQueue> cq_;
+    uint32_t num_threads_ = SERVER_THREADS_;
+    std::vector<std::unique_ptr<ServerCompletionQueue>> cqs_;  // one completion queue per polling thread
+    std::vector<std::thread> cq_threads_;
+    std::unique_ptr<DecodePool> decoder_;
+    std::mutex run_mutex_;  // held while Run() polls, the destructor waits for it
     std::atomic<bool> is_running_{true};
 
-    std::queue<blockchain::Message> mq_;       // consensus message queue
-    std::queue<blockchain::Transaction> txq_;  // new transactions queue
-    std::mutex mq_mutex_;
-    std::mutex txq_mutex_;
+    MPSCQueue<blockchain::Message> mq_{MQ_CAPACITY_};        // consensus message ring, consumed by the consensus thread
+    MPSCQueue<blockchain::Transaction> txq_;                 // new transactions ring, consumed by the tx ingest thread
+    RateLimiter tx_limiter_;                                 // transactions per client address & second
+    std::atomic<uint64_t> tx_rejected_full_{0};
+    std::atomic<uint64_t> consensus_refused_{0};
+    ReorderBuffer reorder_;                                  // puts pipelined consensus messages back in send order
     std::mutex io_mutex_;
     std::unordered_map<uint32_t, blockchain::UTXOlist> utxolists_;
     std::mutex utxolists_mutex_;
-
-    std::condition_variable cv_;
+    BlockProvider block_provider_ = nullptr;
+    std::mutex block_provider_mutex_;
+    KnownBlockFilter known_block_filter_ = nullptr;
+    std::mutex known_block_filter_mutex_;
 };
 }  // namespace comms
 
@@ -59,12 +59,95 @@ class Settings {
 
     std::string getMyValidatorAddress();
 
+    // Returns the number of consensus instances the leader may have in flight at once
+    uint32_t getPipelineDepth() { return pipeline_depth_; };
+    void setPipelineDepth(uint32_t depth) { pipeline_depth_ = depth; };
+
+    // Returns true if the leader disperses erasure coded fragments instead of sending the full block to every validator
+    bool getErasureCoding() { return erasure_coding_; };
+    void setErasureCoding(bool erasure_coding) { erasure_coding_ = erasure_coding; };
+
+    // Returns the number of delivered blocks a validator keeps in full before it compacts them to digest & certificate
+    uint32_t getGcWatermark() { return gc_watermark_; };
+    void setGcWatermark(uint32_t watermark) { gc_watermark_ = watermark; };
+
+    // Returns the number of completion queues & polling threads of the gRPC server, also used as number of decode threads
+    uint32_t getServerThreads() { return server_threads_; };
+    void setServerThreads(uint32_t threads) { server_threads_ = threads; };
+
+    // Returns the interval between keepalive pings on idle client channels & the time to wait for their ack
+    int getKeepaliveTimeMs() { return keepalive_time_ms_; };
+    int getKeepaliveTimeoutMs() { return keepalive_timeout_ms_; };
+    void setKeepalive(int time_ms, int timeout_ms) {
+        keepalive_time_ms_ = time_ms;
+        keepalive_timeout_ms_ = timeout_ms;
+    };
+
+    // Returns the min & max backoff before a client channel reconnects to an unreachable peer
+    int getReconnectBackoffMinMs() { return reconnect_backoff_min_ms_; };
+    int getReconnectBackoffMaxMs() { return reconnect_backoff_max_ms_; };
+    void setReconnectBackoff(int min_ms, int max_ms) {
+        reconnect_backoff_min_ms_ = min_ms;
+        reconnect_backoff_max_ms_ = max_ms;
+    };
+
+    // Returns the max number of unanswered consensus messages per peer
+    uint32_t getSendWindow() { return send_window_; };
+    void setSendWindow(uint32_t window) { send_window_ = window; };
+
+    // Returns the max number of received transactions waiting for the validator
+    uint32_t getTxQueueCapacity() { return tx_queue_capacity_; };
+    void setTxQueueCapacity(uint32_t capacity) { tx_queue_capacity_ = capacity; };
+
+    // Returns the max number of valid transactions & the max bytes they may hold in the memory pool
+    uint32_t getMempoolCapacity() { return mempool_capacity_; };
+    uint64_t getMempoolMaxBytes() { return mempool_max_bytes_; };
+    void setMempoolCapacity(uint32_t capacity) { mempool_capacity_ = capacity; };
+    void setMempoolMaxBytes(uint64_t max_bytes) { mempool_max_bytes_ = max_bytes; };
+
+    // Returns the number of threads verifying transaction signatures in a validator
+    uint32_t getVerifyThreads() { return verify_threads_; };
+    void setVerifyThreads(uint32_t threads) { verify_threads_ = threads; };
+
+    // Returns the number of threads running the tasks of a validator, tasks of one event type stay on one thread
+    uint32_t getEventThreads() { return event_threads_; };
+    void setEventThreads(uint32_t threads) { event_threads_ = threads; };
+
+    // Returns how long the leader collects transactions after the first one arrived before it proposes a block
+    uint32_t getProposeIntervalMs() { return propose_interval_ms_; };
+    void setProposeIntervalMs(uint32_t interval_ms) { propose_interval_ms_ = interval_ms; };
+
+    // Returns the transactions per second & burst size accepted from one client address, a rate of 0 disables the limit
+    uint32_t getTxRateLimit() { return tx_rate_limit_; };
+    uint32_t getTxBurst() { return tx_burst_; };
+    void setTxRateLimit(uint32_t rate, uint32_t burst) {
+        tx_rate_limit_ = rate;
+        tx_burst_ = burst;
+    };
+
    private:
     uint32_t leader_id_;
     std::map<uint32_t, AddressInfo> validators_;
     std::vector<uint32_t> wallets_;
     uint32_t my_validator_id_;
     uint32_t my_wallet_id_;
+    uint32_t pipeline_depth_ = 4;
+    bool erasure_coding_ = false;
+    uint32_t gc_watermark_ = 128;
+    uint32_t server_threads_ = 2;
+    int keepalive_time_ms_ = 10000;
+    int keepalive_timeout_ms_ = 5000;
+    int reconnect_backoff_min_ms_ = 100;
+    int reconnect_backoff_max_ms_ = 5000;
+    uint32_t send_window_ = 8;
+    uint32_t tx_queue_capacity_ = 8192;
+    uint32_t mempool_capacity_ = 100000;
+    uint64_t mempool_max_bytes_ = 64 * 1024 * 1024;
+    uint32_t verify_threads_ = 2;
+    uint32_t event_threads_ = 2;
+    uint32_t propose_interval_ms_ = 1000;
+    uint32_t tx_rate_limit_ = 0;
+    uint32_t tx_burst_ = 100;
 
     void from_json(const json& j, config::Settings& s);
 
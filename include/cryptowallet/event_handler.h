@@ -0,0 +1,125 @@
+#ifndef COSICOIN_CRYPTOWALLET_EVENT_HANDLER_H
+#define COSICOIN_CRYPTOWALLET_EVENT_HANDLER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Max number of subscriptions per event type
+#define EVENT_MAX_SUBSCRIBERS_ 64
+
+namespace cryptowallet {
+
+
+// Represents different types of Event.
+enum class Event {
+    NONE = 0,
+    SYNC = 1 << 0,
+    TX = 1 << 1,
+    PROPOSE = 1 << 2,
+    DBSTORE = 1 << 3
+};
+
+
+/**
+ * @note This class is used to loop and execute the tasks & events of a validator instance.
+ *       Every event type is a channel bound to one worker thread, so the tasks & events of one type
+ *       run in order while independent event types may run in parallel on different workers.
+ *       Posted tasks run exactly once. Subscriptions are explicit, run once per published event
+ *       and are limited to EVENT_MAX_SUBSCRIBERS_ per event type.
+ *       Idle worker threads sleep on a condition variable.
+*/
+class EventHandler {
+    
+public:
+    typedef std::function<void()> HandleEvent;
+    typedef uint64_t SubscriptionId;
+
+    // Event type & one-shot task, the subscribers of the event run if the task is empty
+    struct EventPublishNode {
+        Event event;
+        HandleEvent task;
+    };
+
+public:
+
+    explicit EventHandler(uint32_t num_threads = 1);
+    
+    // forbids copy constructor.
+    EventHandler(const EventHandler&) = delete;
+    
+    ~EventHandler();
+    
+    /**
+     * @brief subscribe to a event, `func` runs once for every later PublishEvent(event)
+     * @return the id to release the subscription with, 0 if the event has EVENT_MAX_SUBSCRIBERS_ subscriptions
+    */
+    SubscriptionId SubscriberEvent(Event event, HandleEvent func);
+
+    /**
+     * @brief unsubscribe the event 
+     * @return false if there is no such subscription
+    */
+    bool releaseSubscriberEvent(Event event, SubscriptionId id);
+
+    /**
+     * @brief publish the event, wakes up the worker thread of the event type.
+     *        Events published after Stop() are dropped.
+    */
+    void PublishEvent(Event event);
+
+    /**
+     * @brief queue a one-shot task on the channel of the event type, it runs once & is dropped afterwards.
+     *        Tasks posted after Stop() are dropped.
+    */
+    void PostTask(Event event, HandleEvent task);
+
+    /**
+     * @brief runs the events published so far & joins the worker threads.
+     * @warning must not be called from a subscribed task.
+    */
+    void Stop();
+
+    uint32_t getNumberOfThreads() const { return workers_.size(); };
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<EventPublishNode> publist;
+        std::thread th;
+    };
+
+    /**
+     * @brief the worker thread processing the published events of its event types.
+    */
+    void EventProcess(Worker& worker);
+
+    void Enqueue_(EventPublishNode node);
+
+    /**
+     * @brief dense index of an event type, the event values are bit flags & would share workers unevenly.
+    */
+    static uint32_t index_(Event event);
+
+    Worker& worker_(Event event) { return *workers_[index_(event) % workers_.size()]; };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{true};
+
+    std::mutex _mutexSubscriber;
+    SubscriptionId next_id_ = 1;
+    std::map<Event, std::vector<std::pair<SubscriptionId, HandleEvent>>> subsMap_;
+};
+
+}  // namespace cryptowallet
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef COSICOIN_CRYPTOWALLET_MEMPOOL_H
+#define COSICOIN_CRYPTOWALLET_MEMPOOL_H
+
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "blockchain/input.h"
+#include "blockchain/transaction.h"
+
+#define MEMPOOL_CAPACITY_ 100000                // default max number of transactions
+#define MEMPOOL_MAX_BYTES_ (64 * 1024 * 1024)  // default max memory held by the transactions
+
+namespace cryptowallet {
+
+/*
+ * Pool of valid transactions waiting for a block
+ *
+ * Transactions are identified by (sender, txID), tx ids are only unique per wallet.
+ * Block assembly takes the oldest transactions first, so no transaction waits behind newer ones.
+ * Lookups by id & by spent output are O(1). Every output is spent by at most one pooled transaction.
+ * Outputs belong to the UTXO set of one wallet, so conflicting transactions always come from the same wallet:
+ * a newer transaction of the wallet (higher tx id) replaces the pending transactions it conflicts with,
+ * an older one is rejected. A delivered block evicts every pooled transaction that spends the same outputs.
+ * Transactions taken for a block stay in the indices as in flight until the block is delivered (removeIncluded)
+ * or dropped (release), so neither a resent copy nor a double spend of them is pooled in the meantime.
+ * Transactions have no fee, so at the count or memory cap the priority is the load of the wallet:
+ * a newcomer evicts the newest pending transactions of the wallet with the most pending transactions,
+ * as long as that wallet keeps at least as many as the newcomer's wallet. A flooding wallet pushes out
+ * only its own transactions, & within a wallet the older transactions stay. In flight ones are never evicted.
+ * All methods are thread safe.
+ */
+class Mempool {
+   public:
+    enum class AddResult { ADDED,      // pooled
+                           REPLACED,   // pooled in place of older pending transactions of the wallet spending the same outputs
+                           DUPLICATE,  // a transaction with the same sender & id is pooled already
+                           CONFLICT,   // a newer or in flight transaction spends one of the same outputs
+                           FULL };     // the count or memory cap is reached & no wallet holds more pending transactions
+
+    explicit Mempool(size_t capacity = MEMPOOL_CAPACITY_, size_t max_bytes = MEMPOOL_MAX_BYTES_) : capacity_(capacity), max_bytes_(max_bytes){};
+
+    /*
+     * Pools `tx`, evicting pending transactions of the most loaded wallet if the pool is full
+     */
+    AddResult add(const blockchain::Transaction& tx);
+
+    /*
+     * Returns what add(tx) would return right now, without changing the pool
+     * Cheap enough to run before the signature check
+     */
+    AddResult check(const blockchain::Transaction& tx);
+
+    bool contains(uint16_t sender_id, uint32_t tx_id);
+
+    /*
+     * Returns true if a pooled transaction other than `tx` spends one of its outputs & `tx` cannot replace it
+     * Cheap enough to run before the signature check
+     */
+    bool conflicts(const blockchain::Transaction& tx);
+
+    /*
+     * Returns up to `max_count` pending transactions, oldest first, & marks them in flight
+     * In flight transactions keep their id & outputs reserved until removeIncluded() or release()
+     */
+    std::vector<blockchain::Transaction> take(size_t max_count = std::numeric_limits<size_t>::max());
+
+    /*
+     * Puts in flight transactions of a dropped block back in front of the pending ones
+     * Returns the number of released transactions
+     */
+    size_t release(const std::vector<blockchain::Transaction>& txs);
+
+    /*
+     * Removes one pending or in flight transaction, returns false if it is not pooled
+     */
+    bool remove(uint16_t sender_id, uint32_t tx_id);
+
+    /*
+     * Removes the transactions of a delivered block & the pooled transactions that spend the same outputs
+     * Returns the number of removed transactions
+     */
+    size_t removeIncluded(const std::vector<blockchain::Transaction>& txs);
+
+    // Pending & in flight transactions, all of them count against the caps
+    size_t size();
+    // Transactions waiting for a block
+    size_t pending();
+    size_t bytes();
+    // Pending transactions evicted at the cap so far
+    size_t evicted();
+    size_t capacity() const { return capacity_; };
+    size_t maxBytes() const { return max_bytes_; };
+
+   private:
+    // (sender id, tx id)
+    typedef std::pair<uint16_t, uint32_t> TxKey;
+    // (sender id, tx id, output index) of a spent output, outputs belong to the UTXO set of their sender
+    typedef std::tuple<uint16_t, uint32_t, uint64_t> Outpoint;
+
+    struct KeyHash {
+        size_t operator()(const TxKey& key) const { return (static_cast<size_t>(key.first) << 32) ^ key.second; };
+        size_t operator()(const Outpoint& out) const {
+            return ((static_cast<size_t>(std::get<0>(out)) << 32) ^ std::get<1>(out)) * 31 + std::get<2>(out);
+        };
+    };
+
+    struct Entry {
+        blockchain::Transaction tx;
+        size_t bytes;
+        std::list<TxKey>::iterator age;  // position in age_, end() while in flight
+    };
+
+    static Outpoint outpoint_(uint16_t sender_id, const blockchain::Input& input) {
+        return Outpoint(sender_id, input.getTxID(), input.getOutputIndex());
+    };
+
+    // Rough memory held by a transaction, dominated by its signature & public key
+    static size_t footprint_(const blockchain::Transaction& tx);
+
+    // conflicts() without locking, collects the transactions `tx` replaces, mutex_ has to be held
+    bool conflicts_(const TxKey& key, const blockchain::Transaction& tx, std::vector<TxKey>& replaced) const;
+
+    // Decides how `tx` is pooled: collects the transactions it replaces & the ones evicted to make room, mutex_ has to be held
+    AddResult plan_(const TxKey& key, const blockchain::Transaction& tx, size_t tx_bytes, std::vector<TxKey>& replaced, std::vector<TxKey>& evicted) const;
+
+    // Removes a pooled transaction from all indices, mutex_ has to be held
+    void erase_(std::unordered_map<TxKey, Entry, KeyHash>::iterator it);
+
+    // Counts a transaction as pending or not pending anymore in the wallet load, mutex_ has to be held
+    void pend_(const TxKey& key);
+    void unpend_(const TxKey& key);
+
+    size_t capacity_;
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    size_t evicted_ = 0;
+
+    std::list<TxKey> age_;                                      // pending transactions, oldest first
+    std::unordered_map<TxKey, Entry, KeyHash> by_id_;           // map<(sender, tx id), entry>
+    std::unordered_map<Outpoint, TxKey, KeyHash> by_outpoint_;  // map<spent output, spending transaction>
+    std::unordered_map<uint16_t, std::set<uint32_t>> pending_by_sender_;  // map<sender, tx ids of its pending transactions>
+    std::set<std::pair<size_t, uint16_t>> load_;                // (number of pending transactions, sender), most loaded wallet last
+    std::mutex mutex_;
+};
+
+}  // namespace cryptowallet
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef COSICOIN_CRYPTOWALLET_TX_PIPELINE_H
+#define COSICOIN_CRYPTOWALLET_TX_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "blockchain/transaction.h"
+#include "comms/decode_pool.h"
+#include "comms/queue.h"
+
+// Max number of verified transactions waiting for the stateful checks
+#define TX_VERIFIED_CAPACITY_ 4096
+
+namespace cryptowallet {
+
+/*
+ * Staged ingest of transactions
+ *
+ *   Submit() -> verify lanes (parallel, stateless) -> verified queue -> commit thread (sequential, stateful)
+ *
+ * The verify stage runs on a DecodePool keyed by sender, so the transactions of one wallet reach the
+ * commit stage in submission order, transactions of different wallets may overtake each other.
+ * Both queues are bounded: a full lane blocks Submit(), a full verified queue blocks the lane.
+ */
+class TxPipeline {
+   public:
+    struct Verified {
+        blockchain::Transaction tx;
+        bool valid;
+    };
+
+    // Checks a transaction without touching shared state, runs on the verify threads
+    typedef std::function<bool(const blockchain::Transaction&)> VerifyFn;
+    // Applies a batch of verified transactions in order, runs on the commit thread only
+    typedef std::function<void(std::vector<Verified>&)> CommitFn;
+
+    TxPipeline(uint32_t num_threads, VerifyFn verify, CommitFn commit);
+    ~TxPipeline();
+
+    TxPipeline(const TxPipeline&) = delete;
+    TxPipeline& operator=(const TxPipeline&) = delete;
+
+    /*
+     * Queues the transactions for verification, blocks while the lane of a sender is full
+     * Transactions submitted after Stop() are dropped
+     */
+    void Submit(std::vector<blockchain::Transaction>& txs);
+
+    /*
+     * Verifies & commits the queued transactions, then joins the threads
+     */
+    void Stop();
+
+    uint32_t getNumberOfThreads() const { return verifiers_.getNumberOfThreads(); };
+
+   private:
+    void RunCommit_();
+
+    VerifyFn verify_;
+    CommitFn commit_;
+    comms::MPSCQueue<Verified> verified_;
+    std::atomic<bool> running_{true};    // accepts transactions
+    std::atomic<bool> committing_{true};  // the commit thread drains the verified queue
+    comms::DecodePool verifiers_;
+    std::thread committer_;
+};
+
+}  // namespace cryptowallet
+
+#endif
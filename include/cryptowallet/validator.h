@@ -10,8 +10,12 @@
 #include "bracha/node.h"
 #include "json/jsonparser.h"
 #include "database/database.h"
+#include "cryptowallet/event_handler.h"
+#include "cryptowallet/mempool.h"
+#include "cryptowallet/tx_pipeline.h"
 
 
+#include <atomic>
 #include <cstdio>
 #include <iostream>
 #include <chrono>
@@ -26,173 +30,12 @@
 #include <vector>
 #include <unistd.h>
 #include <functional>
+#include <memory>
 
 
 namespace cryptowallet {
 
 
-// Represents different types of Event.
-enum class Event {
-    NONE = 0,
-    SYNC = 1 << 0,
-    TX = 1 << 1,
-    PROPOSE = 1 << 2,
-    DBSTORE = 1 << 3
-};
-
-
-/**
- * @note This class is used to loop and execute any registered events for a validator instance.
-*/
-class EventHandler {
-    
-public:
-    typedef std::function<void()> HandleEvent;
-    //typedef void(*HandleEvent)(/*void*, void**/);
-
-    // function call
-    struct EventSubscriberNode {
-        void* _this;
-        HandleEvent func;
-    };
-    
-    // Event type, data unused
-    struct EventPublishNode {
-        Event event;
-        void* data;
-    };
-
-public:
-
-    EventHandler() {
-        std::unique_lock<std::mutex> ulock(_mutexSubscriber, std::defer_lock);
-        _sub_ulock = std::move(ulock);
-
-        std::unique_lock<std::mutex> plock(_mutexPublish, std::defer_lock);
-        _pub_ulock = std::move(plock);
-
-        
-        th = std::thread(std::bind(EventHandler::EventProcess, this));
-        pt_id = th.get_id();
-        //t.detach();
-    }
-    
-    // forbids copy constructor.
-    EventHandler(const EventHandler&) = delete;
-    
-    ~EventHandler() {
-        //if (th.joinable()) th.join();
-    }
-    
-    /**
-     * @brief subscribe to a event
-    */
-    void SubscriberEvent(Event event, EventSubscriberNode node) {
-        _pub_ulock.lock();
-        subsMap_[event].push_back(node);
-        _pub_ulock.unlock();
-    }
-
-    /**
-     * @brief unsubscribe the event 
-     * @note deprecated because of == operator not overloaded
-    */
-    void releaseSubscriberEvent(Event event, EventSubscriberNode node) {
-        _sub_ulock.lock();
-        auto it = subsMap_.find(event);
-        if(it != subsMap_.end()) {
-            for(auto ite = it->second.begin(); ite != it->second.end(); ) {
-                if(ite->_this == node._this /*&& ite->func == node.func*/) {
-                    ite = it->second.erase(ite);
-                }
-                else {
-                    ++ite;
-                }
-            }
-        }
-        _sub_ulock.unlock();
-    }
-
-
-    /**
-     * @brief publish the event.
-    */
-    void PublishEvent(Event event/*, void* data*/) {
-        EventPublishNode node;
-        node.event = event;
-        // node.data = data;
-        
-        _pub_ulock.lock();
-        publist.push_back(node);
-        _pub_ulock.unlock();
-    }
-
-    /**
-     * @brief the event handler thread processing all registered events.
-    */
-    static void* EventProcess(void* _this) {
-
-        EventHandler* th = (EventHandler*)_this;
-        while (1)
-        {
-            EventPublishNode cur {Event::NONE, nullptr};
-
-            th->_mutexPublish.lock();
-            if (th->publist.empty()) {
-                th->_mutexPublish.unlock();
-                continue;
-            }
-
-            cur = th->publist.front();
-            th->publist.pop_front();
-            th->_mutexPublish.unlock();
-            
-            // pop and execute all the registered events of the same event type.
-            th->_mutexSubscriber.lock();
-            auto it = th->subsMap_.find(cur.event);
-            if(it != th->subsMap_.end()) {
-                for(auto ite = it->second.begin(); ite != it->second.end(); ++ite) {
-                    //ite->func(ite->_this, cur.data);
-                    // std::cout << "EventHandler.cc: " << "EventProcess(): " << "running the subscribed task..." << std::endl;
-                    ite->func();
-                }
-            }
-
-            th->_mutexSubscriber.unlock();
-        }
-    }
-
-    /**
-     * @brief Add new events to handle.
-    */
-    template <typename T>
-    void runInLoop(/*void* ber, */
-                   Event event,
-                   T&& task) {
-        PublishEvent(event);
-        EventHandler::EventSubscriberNode node;
-        node.func = task;
-        
-        SubscriberEvent(event, node);
-    }
-
-
-    public:
-        std::mutex _mutexPublish;
-        std::unique_lock<std::mutex> _pub_ulock;
-
-        std::mutex _mutexSubscriber;
-        std::unique_lock<std::mutex> _sub_ulock;
-        
-        std::thread th;
-        std::thread::id pt_id;
-
-        std::list<EventPublishNode> publist;
-        std::map<Event, std::list<EventSubscriberNode>> subsMap_;
-};
-
-
-
 class Validator {
    public:
     explicit Validator(
@@ -205,13 +48,18 @@ class Validator {
                 wallets_ids_(wids), 
                 _grpcServer(grpcServer), 
                 node_(node), 
-                _evecenter(new EventHandler()),
-                my_pk_(signature::Signature::getInstance()) 
+                _evecenter(new EventHandler(settings.getEventThreads())),
+                my_pk_(signature::Signature::getInstance()),
+                memory_pool_(settings.getMempoolCapacity(), settings.getMempoolMaxBytes())
     { 
         _mutex_grpc = new std::mutex();
+        _mutex_state = new std::mutex();
+        _mutex_propose = new std::mutex();
+        _cond_propose = new std::condition_variable();
+        verify_threads_ = settings.getVerifyThreads();
+        propose_interval_ms_ = settings.getProposeIntervalMs();
         port_ = settings.getValidatorInfo(id).port;
         ipaddr_ = settings.getValidatorInfo(id).address;
-        _cond_grpc = _grpcServer->getConditionVariable();
         db_ = new database::Database("../../database"+ std::to_string(id_)+ ".json");
         if (node->isLeader()) {
             node = dynamic_cast<bracha::LeaderNode*>(node); 
@@ -219,7 +67,12 @@ class Validator {
     }
 
     ~Validator() {
+        delete _evecenter;
+        tx_pipeline_.reset();
         delete _mutex_grpc;
+        delete _mutex_state;
+        delete _mutex_propose;
+        delete _cond_propose;
     }
     
     // Warning: only supports move construction and no copy construction due to mutex.
@@ -230,23 +83,35 @@ class Validator {
                              _grpcServer(std::move(v._grpcServer)),
                              node_(std::move(v.node_)),
                              _evecenter(v._evecenter),
-                             _cond_grpc(v._cond_grpc),
                              _mutex_grpc(v._mutex_grpc),
-                             _listen(v._listen),
+                             _mutex_state(v._mutex_state),
+                             _mutex_propose(v._mutex_propose),
+                             _cond_propose(v._cond_propose),
+                             _listen(v._listen.load()),
                              _consensus(v._consensus),
-                             _propose(v._propose),
+                             _propose(v._propose.load()),
                              blk_intervals_(v.blk_intervals_),
+                             verify_threads_(v.verify_threads_),
+                             propose_interval_ms_(v.propose_interval_ms_),
+                             mempool_rejected_(v.mempool_rejected_.load()),
+                             mempool_conflicts_(v.mempool_conflicts_.load()),
+                             txs_pooled_(v.txs_pooled_.load()),
+                             blks_proposed_(v.blks_proposed_.load()),
+                             blks_delivered_(v.blks_delivered_.load()),
                              my_pk_(std::move(v.my_pk_)),
                              pk_sets_(v.pk_sets_),
                              utxo_sets_(v.utxo_sets_),
-                             memory_pool_(v.memory_pool_),
+                             // the pool holds a mutex, validators are moved before they receive transactions
+                             memory_pool_(v.memory_pool_.capacity(), v.memory_pool_.maxBytes()),
                              blk_verify_pks_(v.blk_verify_pks_),
                              db_(v.db_),
                              blk_hashes_(v.blk_hashes_)
     {
         v._evecenter = nullptr;
-        v._cond_grpc = nullptr;
         v._mutex_grpc = nullptr;
+        v._mutex_state = nullptr;
+        v._mutex_propose = nullptr;
+        v._cond_propose = nullptr;
         v._grpcServer = nullptr;
         v.node_ = nullptr;
         v.db_ = nullptr;
@@ -261,11 +126,23 @@ class Validator {
      * @brief Running the threads separately.
     */
     void Run() {
+        tx_pipeline_.reset(new TxPipeline(verify_threads_,
+                                          [this](const blockchain::Transaction& tx) { return VerifyTx(tx); },
+                                          [this](std::vector<TxPipeline::Verified>& txlist) { OnTxReply(txlist); }));
         _listen_th = std::thread(std::bind(&Validator::Listen, this));
         if (node_->isLeader()) _blkpropose_th = std::thread(std::bind(&Validator::ProposeProcess, this));
+        // accepted blocks are applied as soon as consensus delivers them
+        node_->setDeliveryHandler([this](bracha::DeliveredBlock&& delivered) { OnDeliverBlk(std::move(delivered)); });
+        // the txs of an own block that consensus abandoned wait for the next one
+        node_->setAbandonHandler([this](const bracha::InstanceID& instance, blockchain::Block&& blk) { OnAbandonBlk(blk); });
         _consensus_th = std::thread(std::bind(&Validator::ConsensusProcess, this));
-        _DBstore_th = std::thread(std::bind(&Validator::DBProcess, this));
     }
+
+    /**
+     * @brief Wakes up & joins the threads started by Run(), stops the consensus protocol.
+     *        Pending tasks & verified transactions are still handled.
+    */
+    void Stop();
     
     /**
      * @brief distribute a certain amount of coins equally to every wallet.
@@ -281,6 +158,21 @@ class Validator {
 
     inline constexpr uint32_t getId() const { return id_; }
 
+    /**
+     * @brief Number of transactions in the memory pool, number of valid transactions turned away because it was full
+     * & number of transactions turned away because they spend an output that a pooled transaction spends already.
+    */
+    size_t getMemoryPoolSize() { return memory_pool_.size(); }
+    uint64_t getMemoryPoolRejected() const { return mempool_rejected_; }
+    uint64_t getMemoryPoolConflicts() const { return mempool_conflicts_; }
+
+    /**
+     * @brief Number of transactions added to the memory pool, of blocks this leader broadcast & of delivered blocks.
+    */
+    uint64_t getTxsPooled() const { return txs_pooled_; }
+    uint64_t getBlksProposed() const { return blks_proposed_; }
+    uint64_t getBlksDelivered() const { return blks_delivered_; }
+
    private:
     /**
      * @brief update the current public keys according to the newly received Tx.
@@ -289,24 +181,35 @@ class Validator {
     void UpdateKeys(uint32_t sender_id, const blockchain::Transaction& tx);
     
     /**
-     * @brief passes on handling of a newly arrived txlist
+     * @brief Stateless checks of a newly arrived Tx, run in parallel on the verify threads:
+     * a double spend of a pooled transaction or a Tx the memory pool has no room for, even after
+     * replacement & eviction, is turned away before the signature is checked with the public key the Tx carries.
+     *
+     * @param a transaction Tx
+     * @return false a Tx is invalid and discarded
+     * @return true a Tx can be passed on to OnRecvTx
+     */
+    bool VerifyTx(const blockchain::Transaction& tx);
+
+    /**
+     * @brief passes on handling of a newly verified txlist, in arrival order
     */
-    int OnTxReply(std::vector<blockchain::Transaction>& txlist);
+    int OnTxReply(std::vector<TxPipeline::Verified>& txlist);
 
     /**
-     * @brief Upon receiving a new Transaction, 
+     * @brief Upon receiving a verified Transaction, 
      * the validator updates the corresponding public key despite the
-     * possible invalidity of signature; then it checks the signature 
-     * of the transaction using its stored public key; it proceeds to 
+     * possible invalidity of signature; it proceeds to 
      * checks whether the output(h,i) is in the local UTXO set or the 
      * spending conditions are met; finally it adds the current 
      * transactions to the memory pool.
+     * _mutex_state has to be held.
      *
-     * @param a transaction Tx
+     * @param a transaction Tx, result of VerifyTx
      * @return 0 a Tx is invalid and discarded
      * @return 1 a Tx is received
      */
-    int OnRecvTx(blockchain::Transaction& tx);
+    int OnRecvTx(blockchain::Transaction& tx, bool valid);
 
     /**
      * @brief creates a new block:
@@ -404,26 +307,34 @@ class Validator {
     void ConsensusProcess(void);
 
     /**
-     * @brief Thread creating events for proposing new blocks
+     * @brief Thread creating events for proposing new blocks:
+     *        sleeps until transactions enter the memory pool, collects transactions for
+     *        propose_interval_ms_ & proposes once the previous proposal left the event handler.
     */
     void ProposeProcess(void);
 
     /**
-     * @brief Thread detecting any new accepted blocks and do after-agreement operations.
+     * @brief Delivery handler of the node, passes an accepted block on to the event handler for the after-agreement operations.
+     *        Runs on the consensus thread.
+    */
+    void OnDeliverBlk(bracha::DeliveredBlock&& delivered);
+
+    /**
+     * @brief Abandon handler of the node, puts the txs of an abandoned block back in the memory pool
+     *        so they are proposed again & their outputs are not locked forever. Runs on the consensus thread.
     */
-    void DBProcess(void);
+    void OnAbandonBlk(const blockchain::Block& blk);
 
 
     /**
-     * @brief Register a new event to the event handler.
-     *        perfect forward any rvalues if needed : can be very slow.
+     * @brief Queue a one-shot task on the event handler, it runs once on the channel of `event`.
      * @param Event: event
      *        task: functional call
     */
     template <typename T>
     void RunTaskInLoop(Event event, T&& task)
     {
-        _evecenter->runInLoop(/**this,*/ event, std::forward<T>(task));
+        _evecenter->PostTask(event, std::forward<T>(task));
     }
 
    private:
@@ -433,8 +344,16 @@ class Validator {
 
     // one thread in Event Handler for customized events including CreateBlk, RecvTx, etc..
     EventHandler* _evecenter;
-    std::condition_variable* _cond_grpc;
     std::mutex* _mutex_grpc;
+    // guards the UTXO & key sets shared by the tx commit thread and the event handler
+    std::mutex* _mutex_state;
+    // wakes up the proposing thread, notified when txs enter the memory pool, a proposal finished or on Stop()
+    std::mutex* _mutex_propose;
+    std::condition_variable* _cond_propose;
+    bool propose_pending_ = false;  // a proposal waits in the event handler, guarded by _mutex_propose
+
+    // verifies transactions in parallel, then commits them in order on its own thread; created by Run()
+    std::unique_ptr<TxPipeline> tx_pipeline_;
     
    public:
     // one thread for listening from gRPC server
@@ -443,17 +362,26 @@ class Validator {
     std::thread _consensus_th;
     // one thread for constantly proposing a block
     std::thread _blkpropose_th;
-    std::thread _DBstore_th;
    
    private:
     // running control bool for the above threads
-    bool _listen = true;
+    std::atomic<bool> _listen{true};
     bool _consensus = true;
-    bool _propose = true; 
-    bool _DBstore = true;
+    std::atomic<bool> _propose{true};
 
     const uint32_t blk_intervals_ = 20;
 
+    uint32_t verify_threads_ = 2;
+    uint32_t propose_interval_ms_ = 1000;
+
+    // number of valid transactions turned away by a full memory pool & of double spends turned away
+    std::atomic<uint64_t> mempool_rejected_{0};
+    std::atomic<uint64_t> mempool_conflicts_{0};
+    // counted instead of logged, they change with every tx batch & block
+    std::atomic<uint64_t> txs_pooled_{0};
+    std::atomic<uint64_t> blks_proposed_{0};
+    std::atomic<uint64_t> blks_delivered_{0};
+
     /**
      * configuration settings
     */
@@ -484,11 +412,9 @@ class Validator {
   // @warning UNCOMMENT for real use
   //private:
     std::unordered_map<uint32_t, blockchain::UTXOlist> utxo_sets_;
-    std::vector<blockchain::Transaction> memory_pool_;
+    Mempool memory_pool_;
     std::unordered_map<std::string, signature::SigKey> blk_verify_pks_;
     
-    std::vector<blockchain::Block> blist_;
-    
     /**
      * Database
     */
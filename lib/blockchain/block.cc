@@ -55,12 +55,38 @@ Block::Block(const chat::Block& proto_block) : header_(proto_block.header()), id
 
     // Read next pub key
     std::string publickey = proto_block.publickey();
-    validator_next_public_key_ = signature::SigKey_from_string(publickey);
+    if (!publickey.empty()) {
+        validator_next_public_key_ = signature::SigKey_from_string(publickey);
+    }
 
     mutable_ = false;
     empty_ = false;
 }
 
+std::string Block::serializeBody() const {
+    if (mutable_) {
+        throw std::runtime_error("Cannot serialize mutable block.");
+    }
+    chat::Block proto_block;
+    *proto_block.mutable_header() = header_.toProtoHeader();
+    proto_block.set_blockid(id_);
+    for (const blockchain::Transaction& tx : txs_) {
+        tx.toProtoTransaction(proto_block.add_transaction());
+    }
+    return proto_block.SerializeAsString();
+}
+
+bool Block::parseBody(const std::string& body) {
+    chat::Block proto_block;
+    if (!proto_block.ParseFromString(body)) {
+        return false;
+    }
+    txs_.clear();
+    certificate_.clear();
+    fromProtoBlock(proto_block);
+    return true;
+}
+
 /* void Block::fromProtoBlock(const chat::Block& proto_block) {
     // Read header
     header_ = proto_block.header();
@@ -133,6 +159,12 @@ bool Block::verify(blockchain::UTXOlist& utxolist, std::vector<uint32_t>& receiv
     return true;
 }
 
+bool Block::verifyMerkleRoot() const {
+    blockchain::Header header(header_.getPrevBlockDigest());
+    header.calculateMerkleRoot(txs_);
+    return header.getMerkleRoot() == header_.getMerkleRoot();
+}
+
 bool Block::verifyTxConsist(const blockchain::Transaction& new_tx) const {
     // Check that no input already occurs in added transactions
     std::vector<blockchain::Input> new_inputs = new_tx.getInputs();
@@ -198,26 +230,11 @@ bool blockchain::operator==(const Block& lhs, const Block& rhs) {
         return false;
     }
 
-    // Check of validator signatures are equal
-    if (lhs.validatorSigs_.size() != rhs.validatorSigs_.size()) {
+    // Check if certificates are equal
+    if (!(lhs.certificate_ == rhs.certificate_)) {
         return false;
     }
 
-    for (int i = 0; i < lhs.validatorSigs_.size(); i++) {
-        if (lhs.validatorSigs_[i].validator_id != rhs.validatorSigs_[i].validator_id) {
-            return false;
-        }
-        if (lhs.validatorSigs_[i].signature != rhs.validatorSigs_[i].signature) {
-            return false;
-        }
-        if (lhs.validatorSigs_[i].round != rhs.validatorSigs_[i].round) {
-            return false;
-        }
-        if (lhs.validatorSigs_[i].public_key != rhs.validatorSigs_[i].public_key) {
-            return false;
-        }
-    }
-
     return true;
 }
 
@@ -255,15 +272,12 @@ std::string Block::to_string() {
 
     j["validatorID"] = validator_id_;
 
-    j["publicKey"] = signature::SigKey_to_string(validator_next_public_key_);
+    if (!validator_next_public_key_.S0.empty()) {
+        j["publicKey"] = signature::SigKey_to_string(validator_next_public_key_);
+    }
 
-    std::cout << "validatorSigs size: " << validatorSigs_.size() << std::endl;
-    for (BlockSignature sig : validatorSigs_) {
-        std::cout << "validatorSigs: " << sig.validator_id << std::endl;
-        j["validatorSigs"].push_back({{"validator_id", sig.validator_id},
-                                      {"signature", signature::signature_to_json(sig.signature)},
-                                      {"round", sig.round},
-                                      {"public_key", signature::SigKey_to_string(sig.public_key)}});
+    if (!certificate_.empty()) {
+        j["certificate"] = certificate_.to_json();
     }
 
     return j.dump();
@@ -282,18 +296,16 @@ void Block::from_string(std::string block_string) {
     }
     validator_sig_ = signature::json_to_string(j.at("validatorSig"));
     validator_id_ = j.at("validatorID");
-    validator_next_public_key_ = signature::SigKey_from_string(j.at("publicKey"));
-
-    validatorSigs_.clear();
-    if (j.contains("validatorSigs")) {
-        for (const auto& el : j.at("validatorSigs")) {
-            BlockSignature sig;
-            sig.validator_id = el.at("validator_id");
-            sig.signature = signature::json_to_string(el.at("signature"));
-            sig.round = el.at("round");
-            sig.public_key = signature::SigKey_from_string(el.at("public_key"));
-            validatorSigs_.push_back(sig);
-        }
+    validator_next_public_key_ = signature::SigKey();
+    if (j.contains("publicKey")) {
+        validator_next_public_key_ = signature::SigKey_from_string(j.at("publicKey"));
+    }
+
+    // The "validatorSigs" of blocks stored before quorum certificates are not read: they sign the old digest
+    // over the full next public key, which they don't store, so they can't be verified against signingDigest()
+    certificate_.clear();
+    if (j.contains("certificate")) {
+        certificate_.from_json(j.at("certificate"));
     }
 
     empty_ = false;
@@ -304,12 +316,18 @@ std::string Block::getDigest() {
     if (mutable_) {
         throw std::runtime_error("Cannot digest mutable block.");
     }
-    std::string input_str = header_.getID();
-    input_str += std::to_string(validator_id_);
-    if (!validator_next_public_key_.S0.empty() && !validator_next_public_key_.S1.empty()) {
-        input_str += signature::SigKey_to_string(validator_next_public_key_);
+    return signingDigest(header_.getID(), validator_id_, keyHash(validator_next_public_key_));
+}
+
+std::string Block::signingDigest(const std::string& block_hash, uint16_t validator_id, const std::string& next_key_hash) {
+    return signature::hash(block_hash + std::to_string(validator_id) + next_key_hash);
+}
+
+std::string Block::keyHash(const signature::SigKey& public_key) {
+    if (public_key.S0.empty() || public_key.S1.empty()) {
+        return "";
     }
-    return signature::hash(input_str);
+    return signature::hash(signature::SigKey_to_string(public_key));
 }
 
 bool Block::verifySignature(signature::SigKey public_key) {
@@ -321,5 +339,5 @@ void Block::removeSignatures() {
     validator_sig_.clear();
     validator_id_ = 0;
     validator_next_public_key_ = signature::SigKey();
-    validatorSigs_.clear();
+    certificate_.clear();
 }
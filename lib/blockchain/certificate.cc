@@ -0,0 +1,255 @@
+#include "blockchain/certificate.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "blockchain/block.h"
+
+using namespace blockchain;
+
+namespace {
+
+const char HEX_[] = "0123456789abcdef";
+
+std::string to_hex(const std::string& bytes) {
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char c : bytes) {
+        hex.push_back(HEX_[c >> 4]);
+        hex.push_back(HEX_[c & 0x0f]);
+    }
+    return hex;
+}
+
+std::string from_hex(const std::string& hex) {
+    if (hex.size() % 2 != 0) {
+        throw std::runtime_error("Invalid hex string in certificate");
+    }
+    std::string bytes;
+    bytes.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+// Concatenates parts of equal length
+std::string join(const std::vector<std::string>& parts) {
+    std::string joined;
+    for (const std::string& part : parts) {
+        if (part.size() != parts[0].size()) {
+            throw std::runtime_error("Cannot store signature parts of different length in certificate");
+        }
+        joined += part;
+    }
+    return joined;
+}
+
+// Splits in `count` parts of equal length
+std::vector<std::string> split(const std::string& joined, size_t count) {
+    std::vector<std::string> parts;
+    if (count == 0 || joined.size() % count != 0) {
+        throw std::runtime_error("Invalid signature length in certificate");
+    }
+    size_t length = joined.size() / count;
+    for (size_t i = 0; i < count; i++) {
+        parts.push_back(joined.substr(i * length, length));
+    }
+    return parts;
+}
+
+}  // namespace
+
+bool QuorumCertificate::add(const BlockSignature& sig) {
+    if (sig.validator_id >= MAX_SIGNERS_ || sig.signature.size() != KEY_LEN_) {
+        return false;
+    }
+    bool known_key = !sig.public_key.S0.empty();
+    auto it = entries_.find(sig.validator_id);
+    if (it != entries_.end()) {
+        bool had_key = !it->second.key_hash.empty();
+        if (had_key && !known_key) {
+            return false;
+        }
+        if (had_key == known_key && sig.round <= it->second.round) {
+            return false;
+        }
+    }
+
+    Entry entry;
+    entry.signature = sig.signature;
+    entry.round = sig.round;
+    entry.next_key_hash = sig.next_key_hash;
+    if (known_key) {
+        if (sig.public_key.S0.size() != KEY_LEN_ || sig.public_key.S1.size() != KEY_LEN_) {
+            return false;
+        }
+        // Every preimage hashes to the half of the key it reveals, only the other half is kept
+        for (size_t i = 0; i < KEY_LEN_; i++) {
+            std::string opened = signature::hash(sig.signature[i]);
+            if (opened == sig.public_key.S1[i]) {
+                entry.revealed.set(i);
+                entry.unrevealed.push_back(sig.public_key.S0[i]);
+            } else if (opened == sig.public_key.S0[i]) {
+                entry.unrevealed.push_back(sig.public_key.S1[i]);
+            } else {
+                return false;
+            }
+        }
+        entry.key_hash = Block::keyHash(sig.public_key);
+    }
+    entries_[sig.validator_id] = entry;
+    signers_.set(sig.validator_id);
+    return true;
+}
+
+signature::SigKey QuorumCertificate::publicKey(const Entry& entry) {
+    signature::SigKey key;
+    for (size_t i = 0; i < KEY_LEN_; i++) {
+        std::string opened = signature::hash(entry.signature[i]);
+        key.S0.push_back(entry.revealed[i] ? entry.unrevealed[i] : opened);
+        key.S1.push_back(entry.revealed[i] ? opened : entry.unrevealed[i]);
+    }
+    return key;
+}
+
+std::vector<BlockSignature> QuorumCertificate::getSignatures() const {
+    std::vector<BlockSignature> sigs;
+    for (const auto& [validator_id, entry] : entries_) {
+        BlockSignature sig;
+        sig.signature = entry.signature;
+        sig.validator_id = validator_id;
+        sig.round = entry.round;
+        sig.next_key_hash = entry.next_key_hash;
+        if (!entry.key_hash.empty()) {
+            sig.public_key = publicKey(entry);
+        }
+        sigs.push_back(sig);
+    }
+    return sigs;
+}
+
+bool QuorumCertificate::verifyEntry(const std::string& block_hash, uint16_t validator_id, const Entry& entry) {
+    // The rebuilt key has to be the one the validator announced
+    signature::SigKey key = publicKey(entry);
+    if (Block::keyHash(key) != entry.key_hash) {
+        return false;
+    }
+    std::string digest = Block::signingDigest(block_hash, validator_id, entry.next_key_hash);
+    return signature::Verify(digest, entry.signature, key) == 1;
+}
+
+size_t QuorumCertificate::verify(const std::string& block_hash) const {
+    return verify_(block_hash, entries_.size());
+}
+
+size_t QuorumCertificate::verify_(const std::string& block_hash, size_t enough) const {
+    std::vector<std::pair<uint16_t, const Entry*>> batch;
+    for (const auto& [validator_id, entry] : entries_) {
+        // A signature without a known key cannot be checked
+        if (!entry.key_hash.empty()) {
+            batch.push_back({validator_id, &entry});
+        }
+    }
+
+    // A quorum of a small validator set is checked on the calling thread
+    if (batch.size() < PARALLEL_VERIFY_SIGNERS_) {
+        size_t total = 0;
+        for (const auto& [validator_id, entry] : batch) {
+            if (total >= enough) {
+                break;
+            }
+            if (verifyEntry(block_hash, validator_id, *entry)) {
+                total++;
+            }
+        }
+        return total;
+    }
+
+    // Every thread checks a contiguous part of the batch
+    size_t num_threads = std::min<size_t>(batch.size(), std::max(1u, std::thread::hardware_concurrency()));
+    size_t chunk = (batch.size() + num_threads - 1) / num_threads;
+    std::vector<size_t> valid(num_threads, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.push_back(std::thread([&, t]() {
+            for (size_t i = t * chunk; i < std::min(batch.size(), (t + 1) * chunk); i++) {
+                if (verifyEntry(block_hash, batch[i].first, *batch[i].second)) {
+                    valid[t]++;
+                }
+            }
+        }));
+    }
+    size_t total = 0;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads[t].join();
+        total += valid[t];
+    }
+    return total;
+}
+
+void QuorumCertificate::clear() {
+    signers_.reset();
+    entries_.clear();
+}
+
+json QuorumCertificate::to_json() const {
+    json j;
+
+    // Signers bitmap, one bit per validator id
+    j["signers"] = signers_.to_string();
+
+    // Signatures in validator id order, the preimages are hex encoded & concatenated
+    // With a known key the unrevealed half of the key follows, its hashes concatenated
+    j["signatures"] = json::array();
+    for (const auto& [validator_id, entry] : entries_) {
+        std::string sig;
+        for (const std::string& part : entry.signature) {
+            sig += to_hex(part);
+        }
+        json j_sig = {{"round", entry.round},
+                      {"key", entry.key_hash},
+                      {"next_key_hash", entry.next_key_hash},
+                      {"signature", sig}};
+        if (!entry.key_hash.empty()) {
+            j_sig["revealed"] = to_hex(signature::bitset_to_string(entry.revealed));
+            j_sig["unrevealed"] = join(entry.unrevealed);
+        }
+        j["signatures"].push_back(j_sig);
+    }
+
+    return j;
+}
+
+void QuorumCertificate::from_json(const json& j) {
+    clear();
+
+    signers_ = std::bitset<MAX_SIGNERS_>(j.at("signers").get<std::string>());
+    auto sig_it = j.at("signatures").begin();
+    for (uint16_t validator_id = 0; validator_id < MAX_SIGNERS_; validator_id++) {
+        if (!signers_.test(validator_id)) {
+            continue;
+        }
+        if (sig_it == j.at("signatures").end()) {
+            throw std::runtime_error("Missing signature in certificate");
+        }
+        Entry entry;
+        entry.round = sig_it->at("round");
+        entry.key_hash = sig_it->at("key");
+        entry.next_key_hash = sig_it->at("next_key_hash");
+        std::string sig = sig_it->at("signature");
+        for (const std::string& part : split(sig, KEY_LEN_)) {
+            entry.signature.push_back(from_hex(part));
+        }
+        if (!entry.key_hash.empty()) {
+            std::string revealed = from_hex(sig_it->at("revealed").get<std::string>());
+            if (revealed.size() != KEY_LEN_ / 8) {
+                throw std::runtime_error("Invalid public key in certificate");
+            }
+            entry.revealed = signature::string_to_bitset(revealed);
+            entry.unrevealed = split(sig_it->at("unrevealed").get<std::string>(), KEY_LEN_);
+        }
+        entries_[validator_id] = entry;
+        ++sig_it;
+    }
+}
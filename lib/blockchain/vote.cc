@@ -0,0 +1,15 @@
+#include "blockchain/vote.h"
+
+using namespace blockchain;
+
+void Vote::sign(signature::SigKey signing_key, uint16_t validator_id, signature::SigKey next_public_key) {
+    // Save id & key
+    validator_id_ = validator_id;
+    validator_next_public_key_ = next_public_key;
+    // Sign digest
+    validator_sig_ = signature::Sign(getDigest(), signing_key);
+}
+
+bool Vote::verifySignature(signature::SigKey public_key) const {
+    return signature::Verify(getDigest(), validator_sig_, public_key) == 1;
+}
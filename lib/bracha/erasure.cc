@@ -0,0 +1,167 @@
+#include "bracha/erasure.h"
+
+using namespace bracha;
+
+namespace {
+
+// Log & exp tables of GF(2^8) with primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+struct GaloisField {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    GaloisField() {
+        uint16_t x = 1;
+        for (int i = 0; i < 255; i++) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        for (int i = 255; i < 512; i++) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        if (a == 0 || b == 0) {
+            return 0;
+        }
+        return exp[log[a] + log[b]];
+    }
+
+    uint8_t div(uint8_t a, uint8_t b) const {
+        if (a == 0) {
+            return 0;
+        }
+        return exp[log[a] + 255 - log[b]];
+    }
+};
+
+const GaloisField gf;
+
+/*
+ * Lagrange coefficients to evaluate the polynomial through the points `xs` in `x`
+ * In GF(2^8) subtraction is xor
+ */
+std::vector<uint8_t> lagrange(const std::vector<uint8_t>& xs, uint8_t x) {
+    std::vector<uint8_t> coefficients(xs.size());
+    for (size_t j = 0; j < xs.size(); j++) {
+        uint8_t num = 1;
+        uint8_t den = 1;
+        for (size_t m = 0; m < xs.size(); m++) {
+            if (m == j) {
+                continue;
+            }
+            num = gf.mul(num, x ^ xs[m]);
+            den = gf.mul(den, xs[j] ^ xs[m]);
+        }
+        coefficients[j] = gf.div(num, den);
+    }
+    return coefficients;
+}
+
+// Adds coefficient * src to dst
+void mulAdd(std::string& dst, const std::string& src, uint8_t coefficient) {
+    if (coefficient == 0) {
+        return;
+    }
+    for (size_t b = 0; b < dst.size(); b++) {
+        dst[b] = static_cast<char>(static_cast<uint8_t>(dst[b]) ^ gf.mul(coefficient, static_cast<uint8_t>(src[b])));
+    }
+}
+
+}  // namespace
+
+ErasureCode::ErasureCode(uint16_t data_fragments, uint16_t total_fragments) : k_(data_fragments), n_(total_fragments) {
+    if (k_ == 0 || k_ > n_ || n_ > MAX_FRAGMENTS_) {
+        throw std::invalid_argument("Invalid erasure code parameters k: " + std::to_string(k_) + ", n: " + std::to_string(n_));
+    }
+    // Fragment i is the polynomial through the data fragments evaluated in i
+    std::vector<uint8_t> xs;
+    for (uint16_t j = 0; j < k_; j++) {
+        xs.push_back(static_cast<uint8_t>(j));
+    }
+    for (uint16_t i = k_; i < n_; i++) {
+        parity_.push_back(lagrange(xs, static_cast<uint8_t>(i)));
+    }
+}
+
+std::vector<std::string> ErasureCode::encode(const std::string& data) const {
+    // Prefix the length so the padding can be removed when decoding
+    std::string payload;
+    uint64_t length = data.size();
+    for (int i = 7; i >= 0; i--) {
+        payload.push_back(static_cast<char>((length >> (8 * i)) & 0xff));
+    }
+    payload += data;
+
+    size_t fragment_size = (payload.size() + k_ - 1) / k_;
+    payload.resize(fragment_size * k_, '\0');
+
+    std::vector<std::string> fragments;
+    fragments.reserve(n_);
+    for (uint16_t j = 0; j < k_; j++) {
+        fragments.push_back(payload.substr(j * fragment_size, fragment_size));
+    }
+    for (uint16_t i = 0; i < n_ - k_; i++) {
+        std::string parity(fragment_size, '\0');
+        for (uint16_t j = 0; j < k_; j++) {
+            mulAdd(parity, fragments[j], parity_[i][j]);
+        }
+        fragments.push_back(parity);
+    }
+    return fragments;
+}
+
+bool ErasureCode::decode(const std::map<uint16_t, std::string>& fragments, std::string& data) const {
+    // Take the first k valid fragments
+    std::vector<uint8_t> xs;
+    std::vector<const std::string*> ys;
+    size_t fragment_size = 0;
+    for (const auto& [index, fragment] : fragments) {
+        if (index >= n_ || fragment.empty()) {
+            continue;
+        }
+        if (ys.empty()) {
+            fragment_size = fragment.size();
+        } else if (fragment.size() != fragment_size) {
+            return false;
+        }
+        xs.push_back(static_cast<uint8_t>(index));
+        ys.push_back(&fragment);
+        if (ys.size() == k_) {
+            break;
+        }
+    }
+    if (ys.size() < k_) {
+        return false;
+    }
+
+    // Evaluate the polynomial in the indices of the data fragments
+    std::string payload;
+    payload.reserve(fragment_size * k_);
+    for (uint16_t j = 0; j < k_; j++) {
+        std::string fragment(fragment_size, '\0');
+        std::vector<uint8_t> coefficients = lagrange(xs, static_cast<uint8_t>(j));
+        for (size_t m = 0; m < ys.size(); m++) {
+            mulAdd(fragment, *ys[m], coefficients[m]);
+        }
+        payload += fragment;
+    }
+
+    if (payload.size() < 8) {
+        return false;
+    }
+    uint64_t length = 0;
+    for (int i = 0; i < 8; i++) {
+        length = (length << 8) | static_cast<uint8_t>(payload[i]);
+    }
+    if (length > payload.size() - 8) {
+        return false;
+    }
+    data = payload.substr(8, length);
+    return true;
+}
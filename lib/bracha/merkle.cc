@@ -0,0 +1,54 @@
+#include "bracha/merkle.h"
+
+using namespace bracha;
+
+MerkleTree::MerkleTree(const std::vector<std::string>& leaves) : leaf_count_(leaves.size()) {
+    if (leaves.empty()) {
+        throw std::invalid_argument("Cannot build merkle tree without leaves");
+    }
+    std::vector<std::string> level;
+    level.reserve(leaves.size());
+    for (const std::string& leaf : leaves) {
+        level.push_back(signature::hash(leaf));
+    }
+    levels_.push_back(level);
+
+    // Repeat until only one hash left
+    while (levels_.back().size() > 1) {
+        std::vector<std::string>& hashes = levels_.back();
+        // Duplicate last hash if odd number of hashes
+        if (hashes.size() % 2 != 0) {
+            hashes.push_back(hashes.back());
+        }
+        std::vector<std::string> new_hashes;
+        for (size_t i = 0; i < hashes.size(); i += 2) {
+            new_hashes.push_back(signature::hash(hashes[i] + hashes[i + 1]));
+        }
+        levels_.push_back(new_hashes);
+    }
+}
+
+std::vector<std::string> MerkleTree::getProof(size_t index) const {
+    if (index >= leaf_count_) {
+        throw std::out_of_range("No leaf " + std::to_string(index) + " in merkle tree");
+    }
+    std::vector<std::string> proof;
+    for (size_t l = 0; l + 1 < levels_.size(); l++) {
+        proof.push_back(levels_[l][index ^ 1]);
+        index /= 2;
+    }
+    return proof;
+}
+
+bool MerkleTree::verify(const std::string& root, size_t index, const std::string& leaf, const std::vector<std::string>& proof) {
+    std::string node = signature::hash(leaf);
+    for (const std::string& sibling : proof) {
+        if (index % 2 == 0) {
+            node = signature::hash(node + sibling);
+        } else {
+            node = signature::hash(sibling + node);
+        }
+        index /= 2;
+    }
+    return index == 0 && node == root;
+}
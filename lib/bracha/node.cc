@@ -8,105 +8,190 @@ using namespace bracha;
 void bracha::Node::RunProtocol(bool broadcast) {
 
     std::cout << "Node " << id_ << ": Run protocol started" << std::endl;
-    mutex_cons_.lock();
-    should_broadcast_ = broadcast;
+    grpcServer_->setBlockProvider([this](const std::string& blk_hash, blockchain::Block& block) { return provideBlock(blk_hash, block); });
+    grpcServer_->setKnownBlockFilter([this](const std::string& blk_hash) { return isKnownBlock(blk_hash); });
 
-    while (should_broadcast_) {
-        mutex_cons_.unlock();
+    startRunning(broadcast);
+    runLoop();
+}
+
+void bracha::Node::runLoop() {
+    std::thread fetcher(&bracha::Node::RunFetches, this);
+    while (running_) {
         // std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        if (RunTaskInWait()) {
+        // A fetched block wakes this thread without a message, its instance is delivered in the next round
+        if (RunTaskInWait() || fetched_.exchange(false)) {
             broadcastRound();
         }
-        mutex_cons_.lock();
     };
+    mutex_fetch_.lock();
+    mutex_fetch_.unlock();
+    cond_fetch_.notify_all();
+    fetcher.join();
+}
+
+bool bracha::Node::startRunning(bool run) {
+    // The thread may start after Stop() was called, e.g. when the validator stops right away
+    std::lock_guard<std::mutex> lock(mutex_cons_);
+    running_ = run && !stopped_;
+    return running_;
+}
+
+void bracha::Node::Stop() {
+    // Stop answering block fetches, this node can be moved or destroyed after it stopped
+    grpcServer_->setBlockProvider(nullptr);
+    grpcServer_->setKnownBlockFilter(nullptr);
+    mutex_cons_.lock();
+    running_ = false;
+    stopped_ = true;
+    delivery_wakeups_++;
     mutex_cons_.unlock();
+    cond_pipeline_.notify_all();
+    // The wakeup is kept by the queue, a consensus thread that is not waiting yet returns right away
+    grpcServer_->wakeConsensus();
+}
+
+bool bracha::Node::waitDelivery(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_cons_);
+    uint64_t wakeups = delivery_wakeups_;
+    auto ready = [this, wakeups]() { return !accepted_blocks_.empty() || delivery_wakeups_ != wakeups; };
+    if (timeout_ms < 0) {
+        cond_pipeline_.wait(lock, ready);
+    } else {
+        cond_pipeline_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    return !accepted_blocks_.empty();
+}
+
+void bracha::Node::wakeDelivery() {
+    mutex_cons_.lock();
+    delivery_wakeups_++;
+    mutex_cons_.unlock();
+    cond_pipeline_.notify_all();
 }
 
 bool bracha::Node::RunTaskInWait() {
     std::vector<Message> msg_list;
-    std::unique_lock<std::mutex> lck(mutex_grpc_);
-    cond_grpc_->wait(lck, [this]() { return grpcServer_->newConsensusMessages() || !should_broadcast_; });
+    // Only consensus messages wake up this thread, transactions go to the tx ingest thread
+    grpcServer_->waitConsensusMessages();
     // std::this_thread::sleep_for(std::chrono::milliseconds(1000));  // Wait for one second to make sure all messages are in correct group received (easier to debug)
-    grpcServer_->getMessages(msg_list);
-    mutex_grpc_.unlock();
+    if (!grpcServer_->getMessages(msg_list)) {
+        return false;
+    }
     updateRecvMessages(msg_list);
     return true;
 }
 
-// iterate the msg list, add to send, ready and echo.
+// iterate the msg list, add to send, ready and echo of the instance of each message.
 void bracha::Node::updateRecvMessages(const std::vector<Message> msg_list) {
-    // clear the <SEND> so that it does not send multiple ECHO to the same SEND.
-    send_this_round_ = "";
-
-    std::cout << "Node " << id_ << ": renewing msg list #msgs: " << msg_list.size() << std::endl;
-    for (blockchain::Message msg : msg_list) {
-        blockchain::Block block(msg.getBlock());
-        uint64_t blk_id = block.getID();
-        std::string blk_hash = block.getHeader().getID();
-        //mutex_io_->lock();
-        std::cout << "Node " << id_ << ": received block: " << blk_id << ", " << blk_hash.substr(0, 10) << ", message type: " << msg.getType() << ", from node " << msg.getSenderId() << std::endl;
-        //mutex_io_->unlock();
-
-        // Verify the block signature
-        if (!checkBlockSig(block)) {
-            //mutex_io_->lock();
-            std::cout << "Node " << id_ << ": block signature invalid, skipping block" << std::endl;
-            //mutex_io_->unlock();
-            continue;
-        }
+    for (const blockchain::Message& msg : msg_list) {
+        InstanceID instance{msg.getProposerId(), msg.getSequence()};
+        std::string blk_hash;
+        blockchain::BlockSignature sig;
+        sig.round = msg.getRound();
+
+        if (msg.isVote()) {
+            // ECHO & READY only carry the signed block hash, a coded SEND or ECHO adds a fragment
+            const blockchain::Vote& vote = msg.getVote();
+            blk_hash = vote.getBlockHash();
+
+            sig.validator_id = vote.getValidatorID();
+            sig.signature = vote.getValidatorSignature();
+            sig.next_key_hash = blockchain::Block::keyHash(vote.getValidatorNextPublicKey());
+            if (!checkSig(blockchain::Block::signingDigest(blk_hash, sig.validator_id, sig.next_key_hash), sig, vote.getValidatorNextPublicKey())) {
+                //mutex_io_->lock();
+                std::cout << "Node " << id_ << ": vote signature invalid, skipping vote" << std::endl;
+                //mutex_io_->unlock();
+                continue;
+            }
+        } else {
+            const blockchain::Block& block = msg.getBlock();
+            blk_hash = block.getHeader().getID();
+
+            // Verify the block signature
+            sig.validator_id = block.getValidatorID();
+            sig.signature = block.getValidatorSignature();
+            sig.next_key_hash = blockchain::Block::keyHash(block.getValidatorNextPublicKey());
+            if (!checkSig(blockchain::Block::signingDigest(blk_hash, sig.validator_id, sig.next_key_hash), sig, block.getValidatorNextPublicKey())) {
+                //mutex_io_->lock();
+                std::cout << "Node " << id_ << ": block signature invalid, skipping block" << std::endl;
+                //mutex_io_->unlock();
+                continue;
+            }
 
-        // Verify the block
-        if (!verified_blocks_.count(blk_hash)) {
-            // Block not yet verified
-            if (!block.verify(utxolist_, wallet_ids_)) {
+            // The block of a delivered instance is not needed anymore, don't verify or store it again
+            // Neither is a SEND of a block that is delivered or proposed in another instance
+            mutex_cons_.lock();
+            bool stale = isStale(instance) || (msg.getType() == MsgType::SEND && isBoundBlock(blk_hash, instance));
+            mutex_cons_.unlock();
+            if (stale) {
+                continue;
+            }
+
+            // Verify the block, the copy is only made for blocks that are new
+            blockchain::Block received(block);
+            if (!verifyBlock(received)) {
                 //mutex_io_->lock();
                 std::cout << "Node " << id_ << ": block verification failed, skipping block" << std::endl;
                 //mutex_io_->unlock();
                 continue;
-            } else {
-                verified_blocks_.insert(blk_hash);
             }
+            mutex_cons_.lock();
+            storeBlock(blk_hash, received);
+            markSeen(instance, blk_hash);
+            mutex_cons_.unlock();
         }
 
-        // Save the block's signature
-        uint16_t node_id = block.getValidatorID();
-        blockchain::BlockSignature sig;
-        sig.signature = block.getValidatorSignature();
-        sig.public_key = val_sig_keys_[node_id];
-        sig.validator_id = node_id;
-        sig.round = msg.getRound();
+        // Save the signature & skip messages of instances that are already delivered
+        uint16_t node_id = sig.validator_id;
         mutex_cons_.lock();
-        if (blocks_.find(blk_hash) == blocks_.end()) {
-            blocks_[blk_hash] = block;
+        if (isStale(instance)) {
+            // Late votes still complete the certificate of a block that is held in full
+            if (blocks_.find(blk_hash) != blocks_.end()) {
+                addSignature(blk_hash, sig);
+            }
+            mutex_cons_.unlock();
+            continue;
         }
-        blocks_[blk_hash].addValidatorSignature(sig);
-        mutex_cons_.unlock();
-
-        // update the block list
-        if (blk_list_.find(blk_hash) == blk_list_.end()) {
-            blk_list_[blk_hash] = block;
+        if (msg.getType() == MsgType::SEND && isBoundBlock(blk_hash, instance)) {
+            // e.g. a proposer replaying a delivered block under a new sequence
+            mutex_cons_.unlock();
+            std::cout << "Node " << id_ << ": SEND of block " << blk_hash.substr(0, 10) << " bound to another instance, skipping" << std::endl;
+            continue;
         }
+        addSignature(blk_hash, sig);
+        markSeen(instance, blk_hash);
+        // getGauges() reads the instances, only the consensus thread erases them so the reference stays valid
+        Instance& state = instances_[instance];
+        mutex_cons_.unlock();
 
         switch (msg.getType()) {
             case MsgType::SEND: {
                 // std::cout << "Node " << id_ << ": counting SEND from " << msg.getSenderId() << std::endl;
-                send_this_round_ = blk_hash;
+                // Only the proposer can open its instance, and only once
+                if (node_id == instance.proposer && state.send_hash == "") {
+                    // A coded SEND carries the fragment of this node instead of the block, a SEND of a known block neither
+                    if (msg.isVote() && !msg.hasKnownBlock() && !addFragment(state, msg.getFragment(), id_)) {
+                        std::cout << "Node " << id_ << ": invalid fragment in SEND, skipping" << std::endl;
+                        break;
+                    }
+                    state.send_hash = blk_hash;
+                    state.fragment = msg.getFragment();
+                }
                 break;
             }
             case MsgType::ECHO: {
                 // std::cout << "Node " << id_ << ": counting ECHO from " << msg.getSenderId() << std::endl;
-                if (echo_this_round_.find(blk_hash) != echo_this_round_.end())
-                    echo_this_round_[blk_hash]++;
-                else
-                    echo_this_round_[blk_hash] = 1;
+                // A duplicate ECHO is ignored, fragment included
+                if (state.votes.add(blk_hash, Phase::ECHO, node_id) && !msg.getFragment().isEmpty() && !addFragment(state, msg.getFragment(), node_id)) {
+                    std::cout << "Node " << id_ << ": ignoring invalid fragment from node " << node_id << std::endl;
+                }
                 break;
             }
             case MsgType::READY: {
                 // std::cout << "Node " << id_ << ": counting READY from " << msg.getSenderId() << std::endl;
-                if (ready_this_round_.find(blk_hash) != ready_this_round_.end())
-                    ready_this_round_[blk_hash]++;
-                else
-                    ready_this_round_[blk_hash] = 1;
+                // A duplicate READY is ignored
+                state.votes.add(blk_hash, Phase::READY, node_id);
                 break;
             }
             default:
@@ -115,160 +200,558 @@ void bracha::Node::updateRecvMessages(const std::vector<Message> msg_list) {
     }
 }
 
-void print_dict(std::string name, std::unordered_map<std::string, uint64_t> dict) {
-    std::cout << name << ": ";
-    for (const auto& [key, value] : dict) {
-        std::cout << key.substr(0, 10) << ": " << value << ", ";
+bool bracha::Node::verifyBlock(blockchain::Block& block) {
+    std::string blk_hash = block.getHeader().getID();
+    {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        if (verified_blocks_.count(blk_hash)) {
+            return true;
+        }
     }
-    std::cout << std::endl;
+    // The header id only covers the transactions through the merkle root
+    if (!block.verifyMerkleRoot()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_utxo_);
+        if (!block.verify(utxolist_, wallet_ids_)) {
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_cons_);
+    verified_blocks_.insert(blk_hash);
+    return true;
 }
 
-void bracha::Node::broadcastRound() {
-    this->should_broadcast_ = true;
-    bool recv_send = false;
-    // check whether conditions on each round are satisified or not.
+void bracha::Node::storeBlock(const std::string& blk_hash, const blockchain::Block& block) {
+    if (blocks_.find(blk_hash) != blocks_.end()) {
+        return;
+    }
+    std::shared_ptr<blockchain::Block> stored = std::make_shared<blockchain::Block>(block);
+    blocks_[blk_hash] = stored;
+    // Attach the signatures of votes that arrived before the block
+    auto it = pending_sigs_.find(blk_hash);
+    if (it != pending_sigs_.end()) {
+        for (const blockchain::BlockSignature& sig : it->second) {
+            stored->addValidatorSignature(sig);
+        }
+        pending_sigs_.erase(it);
+    }
+}
 
-    //mutex_io_->lock();
-    print_dict("Node " + std::to_string(id_) + ": echo", echo_this_round_);
-    print_dict("Node " + std::to_string(id_) + ": ready", ready_this_round_);
-    //mutex_io_->unlock();
+void bracha::Node::addSignature(const std::string& blk_hash, const blockchain::BlockSignature& sig) {
+    auto it = blocks_.find(blk_hash);
+    if (it == blocks_.end()) {
+        pending_sigs_[blk_hash].push_back(sig);
+    } else {
+        // A reader may still copy the block, it keeps the version it took
+        if (it->second.use_count() > 1) {
+            it->second = std::make_shared<blockchain::Block>(*it->second);
+        }
+        it->second->addValidatorSignature(sig);
+    }
+}
 
-    if (send_this_round_ != "") {
-        broadcastMessage(MsgType::ECHO, blk_list_[send_this_round_], 1);
-        send_this_round_ = "";
+bool bracha::Node::addFragment(Instance& state, const blockchain::Fragment& fragment, uint16_t validator_id) {
+    // Fragment i belongs to validator i
+    if (fragment.index != validator_id || fragment.index >= n_) {
+        return false;
+    }
+    if (!MerkleTree::verify(fragment.root, fragment.index, fragment.data, fragment.proof)) {
+        return false;
     }
+    state.fragments[fragment.root][fragment.index] = fragment.data;
+    return true;
+}
 
-    for (const auto& [blk_hash, nb_recv] : echo_this_round_) {
-        if ((nb_recv >= floor((n_ + f_ + 1) / 2)) && !ready_sent_.count(blk_hash)) {
-            broadcastMessage(MsgType::READY, blk_list_[blk_hash], 2);
-            ready_sent_.insert(blk_hash);
+bracha::Node::Rebuild bracha::Node::reconstructBlock(const std::string& blk_hash, const Instance& state) {
+    ErasureCode code = erasureCode();
+    bool invalid = false;
+    for (const auto& [root, fragments] : state.fragments) {
+        if (fragments.size() < code.getDataFragments()) {
+            continue;
+        }
+        // Malformed fragments or fragments that aren't the encoding of the decoded block: the proposer equivocated
+        std::string body;
+        if (!code.decode(fragments, body) || MerkleTree(code.encode(body)).getRoot() != root) {
+            std::cout << "Node " << id_ << ": fragments of root " << root.substr(0, 10) << " are inconsistent" << std::endl;
+            invalid = true;
+            continue;
+        }
+        blockchain::Block block;
+        if (!block.parseBody(body) || block.getHeader().getID() != blk_hash || !verifyBlock(block)) {
+            std::cout << "Node " << id_ << ": reconstructed block of root " << root.substr(0, 10) << " is invalid" << std::endl;
+            invalid = true;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        storeBlock(blk_hash, block);
+        return Rebuild::REBUILT;
+    }
+    return invalid ? Rebuild::INVALID : Rebuild::INCOMPLETE;
+}
+
+void bracha::Node::requestFetch(const std::string& blk_hash, const VoteTracker& votes) {
+    std::lock_guard<std::mutex> lock(mutex_fetch_);
+    if (!fetching_.insert(blk_hash).second) {
+        return;
+    }
+    // Validators that echoed the block received it in the SEND, ask them first
+    FetchRequest request{blk_hash, {}};
+    for (Phase phase : {Phase::ECHO, Phase::READY}) {
+        VoteSet voters = votes.voters(blk_hash, phase);
+        for (uint16_t i = 0; i < MAX_VALIDATORS_; i++) {
+            if (voters.test(i) && i != id_ && std::find(request.candidates.begin(), request.candidates.end(), i) == request.candidates.end()) {
+                request.candidates.push_back(i);
+            }
         }
     }
+    fetch_queue_.push_back(std::move(request));
+    cond_fetch_.notify_one();
+}
+
+void bracha::Node::RunFetches() {
+    while (true) {
+        FetchRequest request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_fetch_);
+            cond_fetch_.wait(lock, [this]() { return !fetch_queue_.empty() || !running_; });
+            if (!running_) {
+                fetch_queue_.clear();
+                fetching_.clear();
+                return;
+            }
+            request = std::move(fetch_queue_.front());
+            fetch_queue_.pop_front();
+        }
+        bool stored = fetchBlock(request.blk_hash, request.candidates);
+        {
+            // A failed fetch is queued again by a later round
+            std::lock_guard<std::mutex> lock(mutex_fetch_);
+            fetching_.erase(request.blk_hash);
+        }
+        if (stored) {
+            fetched_ = true;
+            grpcServer_->wakeConsensus();
+        }
+    }
+}
+
+bool bracha::Node::fetchBlock(const std::string& blk_hash, const std::vector<uint16_t>& candidates) {
+    for (uint16_t validator_id : candidates) {
+        if (!running_) {
+            return false;
+        }
+        blockchain::Block block;
+        if (!grpcClient_.FetchBlock(blk_hash, validator_id, block)) {
+            continue;
+        }
+        if (block.getHeader().getID() != blk_hash || !verifyBlock(block)) {
+            std::cout << "Node " << id_ << ": fetched block " << blk_hash.substr(0, 10) << " from node " << validator_id << " is invalid" << std::endl;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        storeBlock(blk_hash, block);
+        return true;
+    }
+    return false;
+}
+
+bool bracha::Node::isKnownBlock(const std::string& blk_hash) const {
+    std::lock_guard<std::mutex> lock(mutex_cons_);
+    // Only a verified block skips the body, a delivered one has to be refused as a SEND of a new instance
+    return verified_blocks_.count(blk_hash) > 0 && !isDeliveredBlock(blk_hash);
+}
+
+bool bracha::Node::provideBlock(const std::string& blk_hash, blockchain::Block& block) {
+    std::shared_ptr<blockchain::Block> stored;
+    {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        auto it = blocks_.find(blk_hash);
+        if (it == blocks_.end()) {
+            return false;
+        }
+        stored = it->second;
+    }
+    // The collected signatures are not serialized, the fetching node has its own
+    block = *stored;
+    return true;
+}
+
+void bracha::Node::broadcastRound() {
+    // check whether conditions on each instance are satisified or not.
+    std::vector<std::pair<InstanceID, std::string>> to_deliver;
+    std::vector<std::pair<InstanceID, std::shared_ptr<blockchain::Block>>> abandoned;
+    for (auto& [instance, state] : instances_) {
+        if (state.delivered) {
+            continue;
+        }
+
+        if (state.send_hash != "" && !state.echo_sent) {
+            broadcastVote(MsgType::ECHO, state.send_hash, 1, instance, state.fragment);
+            state.echo_sent = true;
+        }
 
-    for (const auto& [blk_hash, nb_recv] : ready_this_round_) {
-        if ((nb_recv >= f_ + 1) && !ready_sent_.count(blk_hash)) {
-            broadcastMessage(MsgType::READY, blk_list_[blk_hash], 3);
-            ready_sent_.insert(blk_hash);
+        std::string echoed = state.votes.reached(Phase::ECHO, floor((n_ + f_ + 1) / 2));
+        if (echoed != "" && !state.ready_sent) {
+            broadcastVote(MsgType::READY, echoed, 2, instance);
+            state.ready_sent = true;
+        }
+
+        std::string readied = state.votes.reached(Phase::READY, f_ + 1);
+        if (readied != "" && !state.ready_sent) {
+            broadcastVote(MsgType::READY, readied, 3, instance);
+            state.ready_sent = true;
         }
 
         // delivering conditions
-        if (nb_recv > 2 * f_ + 1) {
-            std::cout << "Node " << id_ << ": Delivering conditions reached for block: " << blk_hash.substr(0, 10) << std::endl;
-            mutex_cons_.lock();
-            this->should_broadcast_ = false;
-            this->voted_hash_ = blk_hash;
-            mutex_cons_.unlock();
-            // remove block from counters
-            echo_this_round_.erase(blk_hash);
-            ready_this_round_.erase(blk_hash);
+        std::string accepted = state.votes.reached(Phase::READY, 2 * f_ + 2);
+        if (accepted != "") {
+            std::shared_ptr<blockchain::Block> stored;
+            bool verified = false;
             mutex_cons_.lock();
-            accepted_blocks_.push_back(blk_hash);
+            auto known = blocks_.find(accepted);
+            if (known != blocks_.end()) {
+                stored = known->second;
+                verified = verified_blocks_.count(accepted) > 0;
+            }
             mutex_cons_.unlock();
+            if (stored && !verified && erasure_coding_) {
+                // A coded SEND is echoed before the block can be verified, so the proposer verifies its own block here
+                // Without coding the correct validators only echo verified blocks, rebuilt & fetched blocks are verified already
+                blockchain::Block block(*stored);
+                if (!verifyBlock(block)) {
+                    std::cout << "Node " << id_ << ": block " << accepted.substr(0, 10) << " of instance " << instance.proposer << ":" << instance.sequence << " is invalid, abandoning the instance" << std::endl;
+                    abandoned.push_back({instance, stored});
+                    accepted = "";
+                }
+            } else if (!stored) {
+                // The votes only carry the hash, rebuild the block from the fragments or fetch it from a voter meanwhile
+                Rebuild rebuilt = reconstructBlock(accepted, state);
+                if (rebuilt == Rebuild::INCOMPLETE) {
+                    requestFetch(accepted, state.votes);
+                    continue;
+                }
+                if (rebuilt == Rebuild::INVALID) {
+                    // No correct validator can deliver the block either, the next sequences of the proposer go on without it
+                    std::cout << "Node " << id_ << ": block " << accepted.substr(0, 10) << " of instance " << instance.proposer << ":" << instance.sequence << " can't be rebuilt, abandoning the instance" << std::endl;
+                    accepted = "";
+                }
+            }
+            to_deliver.push_back({instance, accepted});
+        }
+    }
+
+    if (to_deliver.empty()) {
+        return;
+    }
+    mutex_cons_.lock();
+    for (const auto& [instance, blk_hash] : to_deliver) {
+        deliver(instance, blk_hash);
+    }
+    if (abandon_handler_) {
+        abandoned_.insert(abandoned_.end(), abandoned.begin(), abandoned.end());
+    }
+    mutex_cons_.unlock();
+    cond_pipeline_.notify_all();
+    handDeliveries();
+}
+
+void bracha::Node::handDeliveries() {
+    std::vector<DeliveredBlock> deliveries;
+    DeliveryHandler handler;
+    std::vector<std::pair<InstanceID, std::shared_ptr<blockchain::Block>>> abandoned;
+    AbandonHandler abandon_handler;
+    mutex_cons_.lock();
+    deliveries.swap(deliveries_);
+    handler = delivery_handler_;
+    abandoned.swap(abandoned_);
+    abandon_handler = abandon_handler_;
+    if (!handler) {
+        // The handler was removed meanwhile, the blocks go to getConsensusBlocks()
+        for (const DeliveredBlock& delivered : deliveries) {
+            accepted_blocks_.push_back(delivered.block.getHeader().getID());
+        }
+        accepted_count_ = accepted_blocks_.size();
+        deliveries.clear();
+    }
+    mutex_cons_.unlock();
+    for (DeliveredBlock& delivered : deliveries) {
+        handler(std::move(delivered));
+    }
+    if (abandon_handler) {
+        for (const auto& [instance, block] : abandoned) {
+            abandon_handler(instance, blockchain::Block(*block));
+        }
+    }
+}
+
+void bracha::Node::deliver(const InstanceID& instance, const std::string& blk_hash) {
+    // release the votes, only the delivered flag is needed until the instance is accepted
+    Instance& state = instances_[instance];
+    state.delivered = true;
+    state.votes.clear();
+    state.fragments.clear();
+    delivered_[instance] = blk_hash;
+    // The block is kept until it is accepted, however long the previous sequences take
+    auto seen = seen_.find(instance);
+    if (seen != seen_.end()) {
+        seen->second.erase(blk_hash);
+    }
+
+    // Accept the delivered blocks of this proposer in sequence order
+    uint64_t next = nextDelivery(instance.proposer);
+    auto it = delivered_.find({instance.proposer, next});
+    while (it != delivered_.end()) {
+        // An abandoned instance only passes its sequence on
+        auto block = it->second == "" ? blocks_.end() : blocks_.find(it->second);
+        if (it->second != "" && block == blocks_.end()) {
+            std::cout << "Node " << id_ << ": delivered block " << it->second.substr(0, 10) << " of instance " << it->first.proposer << ":" << it->first.sequence << " is missing, abandoning the instance" << std::endl;
+        }
+        if (block != blocks_.end()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_voted_);
+                voted_hash_ = it->second;
+            }
+            delivered_height_++;
+            delivered_log_.push_back({delivered_height_, it->second});
+            if (delivery_handler_) {
+                deliveries_.push_back(DeliveredBlock{it->first, delivered_height_, *block->second});
+            } else {
+                accepted_blocks_.push_back(it->second);
+                accepted_count_ = accepted_blocks_.size();
+            }
+        }
+        instances_.erase(it->first);
+        delivered_.erase(it);
+        next++;
+        it = delivered_.find({instance.proposer, next});
+    }
+    next_delivery_[instance.proposer] = next;
+
+    // Blocks & signatures the passed instances did not deliver expire, e.g. equivocating proposals
+    auto first = seen_.lower_bound({instance.proposer, 0});
+    auto last = seen_.lower_bound({instance.proposer, next});
+    for (auto seen = first; seen != last; seen++) {
+        for (const std::string& hash : seen->second) {
+            // A vote may name the block of another instance, delivered blocks are collected by collectGarbage()
+            if (isBlockInUse(hash)) {
+                continue;
+            }
+            blocks_.erase(hash);
+            pending_sigs_.erase(hash);
+            verified_blocks_.erase(hash);
+        }
+    }
+    seen_.erase(first, last);
+    collectGarbage();
+}
+
+bool bracha::Node::isStale(const InstanceID& instance) const {
+    uint64_t next = nextDelivery(instance.proposer);
+    // Peers run ahead by their pipeline, anything beyond a watermark on top of that is not kept
+    uint64_t horizon = uint64_t(gc_watermark_) + pipeline_depth_;
+    return instance.sequence < next || delivered_.count(instance) || instance.sequence >= next + horizon;
+}
+
+void bracha::Node::markSeen(const InstanceID& instance, const std::string& blk_hash) {
+    seen_[instance].insert(blk_hash);
+}
+
+bool bracha::Node::isDeliveredBlock(const std::string& blk_hash) const {
+    return std::any_of(delivered_log_.begin(), delivered_log_.end(), [&](const auto& entry) { return entry.second == blk_hash; }) ||
+           std::any_of(delivered_.begin(), delivered_.end(), [&](const auto& entry) { return entry.second == blk_hash; }) ||
+           std::any_of(compacted_.begin(), compacted_.end(), [&](const CompactedBlock& entry) { return entry.hash == blk_hash; });
+}
+
+bool bracha::Node::isBoundBlock(const std::string& blk_hash, const InstanceID& instance) const {
+    if (isDeliveredBlock(blk_hash)) {
+        return true;
+    }
+    return std::any_of(instances_.begin(), instances_.end(), [&](const auto& entry) { return !(entry.first == instance) && entry.second.send_hash == blk_hash; });
+}
+
+bool bracha::Node::isBlockInUse(const std::string& blk_hash) const {
+    if (isDeliveredBlock(blk_hash)) {
+        return true;
+    }
+    // The instances delivered later in the same round still hold their votes
+    return std::any_of(instances_.begin(), instances_.end(), [&](const auto& entry) {
+        const Instance& state = entry.second;
+        return !state.delivered && (state.send_hash == blk_hash || state.votes.count(blk_hash, Phase::ECHO) > 0 || state.votes.count(blk_hash, Phase::READY) > 0);
+    });
+}
+
+void bracha::Node::collectGarbage() {
+    // Delivered blocks a watermark behind are compacted, fetches of lagging validators need the full block before that
+    while (!delivered_log_.empty() && delivered_log_.front().first + gc_watermark_ <= delivered_height_) {
+        const auto& [height, blk_hash] = delivered_log_.front();
+        if (std::find(accepted_blocks_.begin(), accepted_blocks_.end(), blk_hash) != accepted_blocks_.end()) {
             break;
         }
+        auto it = blocks_.find(blk_hash);
+        if (it != blocks_.end()) {
+            compacted_.push_back(CompactedBlock{height, blk_hash, it->second->getCertificate()});
+            blocks_.erase(it);
+        }
+        verified_blocks_.erase(blk_hash);
+        pending_sigs_.erase(blk_hash);
+        delivered_log_.pop_front();
+    }
+    while (!compacted_.empty() && compacted_.front().height + 2 * uint64_t(gc_watermark_) <= delivered_height_) {
+        compacted_.pop_front();
+    }
+}
+
+uint64_t bracha::Node::nextDelivery(uint16_t proposer) const {
+    auto it = next_delivery_.find(proposer);
+    if (it == next_delivery_.end()) {
+        return 1;
     }
+    return it->second;
 }
 
-void bracha::Node::broadcastMessage(blockchain::MsgType type, blockchain::Block block, uint16_t round) {
+void bracha::Node::broadcastMessage(blockchain::MsgType type, blockchain::Block block, uint16_t round, InstanceID instance) {
+    // Signing & queueing under one lock keeps the order of the signing keys of this node
+    mutex_grpc_.lock();
     signBlock(block);
-    //mutex_io_->lock();
-    std::cout << "Node " << id_ << ": Broadcasting block " << block.getHeader().getID().substr(0, 10) << " in message type " << type << std::endl;
-    //mutex_io_->unlock();
-    blockchain::Message msg = Message(type, block, id_, round);
+    if (type == MsgType::SEND) {
+        // The proposer keeps the full block, its own SEND is decoded without the transactions
+        mutex_cons_.lock();
+        storeBlock(block.getHeader().getID(), block);
+        mutex_cons_.unlock();
+    }
+    blockchain::Message msg = Message(type, block, id_, round, instance.proposer, instance.sequence);
+    grpcClient_.Broadcast(msg);
+    mutex_grpc_.unlock();
+}
+
+void bracha::Node::broadcastVote(blockchain::MsgType type, const std::string& blk_hash, uint16_t round, InstanceID instance, const blockchain::Fragment& fragment) {
+    // Signing & queueing under one lock keeps the order of the signing keys of this node
     mutex_grpc_.lock();
+    blockchain::Vote vote(blk_hash);
+    signVote(vote);
+    blockchain::Message msg = Message(type, vote, id_, round, instance.proposer, instance.sequence);
+    msg.setFragment(fragment);
     grpcClient_.Broadcast(msg);
     mutex_grpc_.unlock();
 }
 
-void bracha::LeaderNode::RunProtocol(bool broadcast) {
-    mutex_cons_.lock();
-    should_broadcast_ = broadcast;
+void bracha::Node::broadcastFragments(const blockchain::Block& block, InstanceID instance) {
+    std::string blk_hash = block.getHeader().getID();
+    std::vector<std::string> fragments = erasureCode().encode(block.serializeBody());
+    MerkleTree tree(fragments);
 
-    while (should_broadcast_) {
-        mutex_cons_.unlock();
-        if (RunTaskInWait()) {
-            broadcastRound();
-        }
-        mutex_cons_.lock();
-    };
+    // The proposer keeps the full block
+    mutex_cons_.lock();
+    storeBlock(blk_hash, block);
     mutex_cons_.unlock();
+
+    // One signature for all validators keeps the signing keys of this node in the same order everywhere
+    mutex_grpc_.lock();
+    blockchain::Vote vote(blk_hash);
+    signVote(vote);
+    blockchain::Message msg = Message(MsgType::SEND, vote, id_, 0, instance.proposer, instance.sequence);
+    for (uint16_t i = 0; i < fragments.size(); i++) {
+        msg.setFragment(blockchain::Fragment{i, fragments[i], tree.getRoot(), tree.getProof(i)});
+        grpcClient_.Send(msg, i);
+    }
+    mutex_grpc_.unlock();
 }
 
 int bracha::LeaderNode::Propose(blockchain::Block& bx) {
-    std::cout << "Node.cc:  " << "propose started " << std::endl;
-    broadcastMessage(blockchain::MsgType::SEND, bx, 0);
-    std::cout << "Node.cc:  " << "propose ended " << std::endl;
+    InstanceID instance;
+    {
+        // Wait for a free slot in the pipeline, a stopped node doesn't open instances even if a slot is free
+        std::unique_lock<std::mutex> lock(mutex_cons_);
+        cond_pipeline_.wait(lock, [this]() { return next_sequence_ - nextDelivery(id_) < pipeline_depth_ || !running_; });
+        if (!running_) {
+            return 0;
+        }
+        instance = InstanceID{id_, next_sequence_++};
+    }
+    if (erasure_coding_) {
+        broadcastFragments(bx, instance);
+    } else {
+        broadcastMessage(blockchain::MsgType::SEND, bx, 0, instance);
+    }
     return 1;
 }
 
-void bracha::Node::signBlock(blockchain::Block& block) {
+signature::SigKey bracha::Node::rotateKeys() {
     my_current_private_key_ = my_next_key_pair_.getPrivateKey();
     my_current_public_key_ = my_next_key_pair_.getPublicKey();
     my_next_key_pair_.KeyGen();
-    signature::SigKey my_next_pub_key = my_next_key_pair_.getPublicKey();
-    //mutex_io_->lock();
-    std::cout << "Node " << id_ << ": signing block " << block.getHeader().getID().substr(0, 10) << " for pub key: " << signature::print_SigKey(my_current_public_key_) << " with next key: " << signature::print_SigKey(my_next_pub_key) << std::endl;
-    //mutex_io_->unlock();
+    return my_next_key_pair_.getPublicKey();
+}
+
+void bracha::Node::signBlock(blockchain::Block& block) {
+    signature::SigKey my_next_pub_key = rotateKeys();
     block.sign(my_current_private_key_, id_, my_next_pub_key);
     assert(signature::Verify(block.getDigest(), block.getValidatorSignature(), my_current_public_key_));
 }
 
-bool bracha::Node::checkBlockSig(const blockchain::Block blk) {
-    blockchain::Block block(blk);
+void bracha::Node::signVote(blockchain::Vote& vote) {
+    signature::SigKey my_next_pub_key = rotateKeys();
+    vote.sign(my_current_private_key_, id_, my_next_pub_key);
+    assert(vote.verifySignature(my_current_public_key_));
+}
+
+bool bracha::Node::checkSig(const std::string& digest, blockchain::BlockSignature& sig, const signature::SigKey& next_public_key) {
     int valid = 1;  // default: accept signature if no public key known
-    std::vector<std::string> signature = block.getValidatorSignature();
-    uint16_t node_id = block.getValidatorID();
-    std::string block_digest = block.getDigest();
+    uint16_t node_id = sig.validator_id;
     // Check if we have the pub key for this node
-    if (val_sig_keys_.find(node_id) != val_sig_keys_.end()) {
+    auto key = val_sig_keys_.find(node_id);
+    if (key != val_sig_keys_.end()) {
         // Node ID found in the map, we can check the signature
-        valid = signature::Verify(block_digest, signature, val_sig_keys_[node_id]);
-        //mutex_io_->lock();
-        std::cout << "Node " << id_ << ": signature from node " << node_id << " for block " << block_digest.substr(0, 10) << " with key " << signature::print_SigKey(val_sig_keys_[node_id]) << " -> valid: " << valid << std::endl;
-        //mutex_io_->unlock();
+        sig.public_key = key->second;
+        valid = signature::Verify(digest, sig.signature, sig.public_key);
     }
     // Save the next pub key
-    val_sig_keys_[node_id] = block.getValidatorNextPublicKey();
-    //mutex_io_->lock();
-    std::cout << "Node " << id_ << ": added next pub key for node " << node_id << ": " << signature::print_SigKey(block.getValidatorNextPublicKey()) << std::endl;
-    //mutex_io_->unlock();
+    val_sig_keys_[node_id] = next_public_key;
     return valid == 1;
 }
 
 blockchain::Block Node::getReceivedBlock(std::string block_hash) {
-    std::lock_guard<std::mutex> lock(mutex_cons_);
-    // Check if the block is in the list of received blocks
-    if (blocks_.find(block_hash) != blocks_.end()) {
-        return blockchain::Block(blocks_[block_hash]);
+    std::shared_ptr<blockchain::Block> stored;
+    {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        // Check if the block is in the list of received blocks
+        auto it = blocks_.find(block_hash);
+        if (it == blocks_.end()) {
+            return blockchain::Block();
+        }
+        stored = it->second;
     }
-    return blockchain::Block();
+    return blockchain::Block(*stored);
 }
 
 std::vector<blockchain::Block> Node::getConsensusBlocks(bool erase) {
-    std::lock_guard<std::mutex> lock(mutex_cons_);
-    std::vector<blockchain::Block> blocks;
-    for (std::string hash : accepted_blocks_) {
-        blocks.push_back(blocks_[hash]);
+    std::vector<std::shared_ptr<blockchain::Block>> stored;
+    {
+        std::lock_guard<std::mutex> lock(mutex_cons_);
+        for (const std::string& hash : accepted_blocks_) {
+            auto it = blocks_.find(hash);
+            if (it != blocks_.end()) {
+                stored.push_back(it->second);
+            }
+        }
+        if (erase) {
+            accepted_blocks_.clear();
+            accepted_count_ = 0;
+        }
     }
-    if (erase) {
-        accepted_blocks_.clear();  // TODO
-        should_broadcast_ = false;
+    std::vector<blockchain::Block> blocks;
+    blocks.reserve(stored.size());
+    for (const std::shared_ptr<blockchain::Block>& block : stored) {
+        blocks.push_back(*block);
     }
     return blocks;
 }
 
 void bracha::FaultNode::RunProtocol(bool broadcast, bracha::ByzantineBehavior behaviour) {
     std::cout << "Faulty node " << id_ << ": Run protocol started in mode: " << byzantineBehavior2String(behaviour) << std::endl;
-    mutex_cons_.lock();
-    should_broadcast_ = behaviour != ByzantineBehavior::CRASH;
-
-    while (should_broadcast_) {
-        mutex_cons_.unlock();
-        // std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        if (RunTaskInWait()) {
-            broadcastRound();
-        }
-        mutex_cons_.lock();
-    };
-    mutex_cons_.unlock();
+    if (startRunning(behaviour != ByzantineBehavior::CRASH)) {
+        runLoop();
+    }
 }
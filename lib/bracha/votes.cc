@@ -0,0 +1,73 @@
+#include "bracha/votes.h"
+
+using namespace bracha;
+
+VoteTracker::Entry* VoteTracker::find(const std::string& digest) {
+    for (Entry& entry : entries_) {
+        if (entry.digest == digest) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const VoteTracker::Entry* VoteTracker::find(const std::string& digest) const {
+    return const_cast<VoteTracker*>(this)->find(digest);
+}
+
+bool VoteTracker::add(const std::string& digest, Phase phase, uint16_t validator_id) {
+    if (validator_id >= MAX_VALIDATORS_) {
+        return false;
+    }
+    Entry* entry = find(digest);
+    if (entry == nullptr) {
+        entries_.push_back(Entry{digest, {}});
+        entry = &entries_.back();
+    }
+    VoteSet& votes = entry->votes[static_cast<int>(phase)];
+    if (votes.test(validator_id)) {
+        // Duplicate vote
+        return false;
+    }
+    votes.set(validator_id);
+    return true;
+}
+
+size_t VoteTracker::count(const std::string& digest, Phase phase) const {
+    const Entry* entry = find(digest);
+    if (entry == nullptr) {
+        return 0;
+    }
+    return entry->votes[static_cast<int>(phase)].count();
+}
+
+std::string VoteTracker::reached(Phase phase, size_t threshold) const {
+    for (const Entry& entry : entries_) {
+        if (entry.votes[static_cast<int>(phase)].count() >= threshold) {
+            return entry.digest;
+        }
+    }
+    return "";
+}
+
+VoteSet VoteTracker::voters(const std::string& digest, Phase phase) const {
+    const Entry* entry = find(digest);
+    if (entry == nullptr) {
+        return VoteSet();
+    }
+    return entry->votes[static_cast<int>(phase)];
+}
+
+std::string VoteTracker::to_string() const {
+    std::string str;
+    for (const Entry& entry : entries_) {
+        str += entry.digest.substr(0, 10) + ": echo " + std::to_string(entry.votes[static_cast<int>(Phase::ECHO)].count()) +
+               ", ready " + std::to_string(entry.votes[static_cast<int>(Phase::READY)].count()) + "; ";
+    }
+    return str;
+}
+
+void VoteTracker::clear() {
+    // Swap with an empty vector to give the memory back
+    std::vector<Entry>().swap(entries_);
+}
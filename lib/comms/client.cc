@@ -20,6 +20,7 @@ void ChatClient::Talk(const blockchain::Message &message) {
 
     // The actual RPC.
     Status status = stub_->Talk(&context, request, &reply);
+    record_(status);
 }
 
 void ChatClient::Sync(const uint32_t wallet_id, blockchain::UTXOlist *utxolist) {
@@ -31,11 +32,12 @@ void ChatClient::Sync(const uint32_t wallet_id, blockchain::UTXOlist *utxolist)
     ClientContext context;
 
     Status status = stub_->Sync(&context, request, &reply);
+    record_(status);
 
     utxolist->fromProtoUTXOlist(reply.utxolist());
 }
 
-void ChatClient::NewTx(const blockchain::Transaction &transaction) {
+bool ChatClient::NewTx(const blockchain::Transaction &transaction) {
     chat::NewTransaction request;
     chat::Transaction proto_tx;
     transaction.toProtoTransaction(&proto_tx);
@@ -43,50 +45,91 @@ void ChatClient::NewTx(const blockchain::Transaction &transaction) {
     chat::Ack reply;
     ClientContext context;
     Status status = stub_->NewTx(&context, request, &reply);
+    record_(status);
+    return status.ok();
+}
+
+bool ChatClient::NewTxBatch(const std::vector<blockchain::Transaction> &transactions, std::vector<chat::TxCode> *codes) {
+    chat::TxBatch request;
+    for (const blockchain::Transaction &transaction : transactions) {
+        transaction.toProtoTransaction(request.add_transactions());
+    }
+    chat::TxBatchAck reply;
+    ClientContext context;
+    Status status = stub_->NewTxBatch(&context, request, &reply);
+    record_(status);
+    if (!status.ok()) {
+        return false;
+    }
+    for (int code : reply.codes()) {
+        codes->push_back(static_cast<chat::TxCode>(code));
+    }
+    return true;
+}
+
+bool ChatClient::FetchBlock(const std::string &block_hash, blockchain::Block *block) {
+    chat::BlockReq request;
+    request.set_blockhash(block_hash);
+    chat::BlockReply reply;
+    ClientContext context;
+    // Don't hang the fetch thread of the node on an unresponsive validator
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(FETCH_TIMEOUT_S_));
+    Status status = stub_->FetchBlock(&context, request, &reply);
+    record_(status);
+    if (!status.ok() || !reply.found()) {
+        return false;
+    }
+    block->fromProtoBlock(reply.block());
+    return true;
+}
+
+void ChatClient::record_(const Status &status) {
+    if (connections_ != nullptr) {
+        connections_->recordResult(address_, status);
+    }
 }
 
 // -------------------------------- WalletClientImpl -----------------------------------
 
 int WalletClientImpl::SendToLeader(const blockchain::Transaction transaction) {
-    ChatClient chat(grpc::CreateChannel(leader_, grpc::InsecureChannelCredentials()));
-    chat.NewTx(transaction);
+    ChatClient chat(connections_.get(), leader_);
+    if (!chat.NewTx(transaction)) {
+        return 0;
+    }
 
     return 1;
 }
 
+int WalletClientImpl::SendBatchToLeader(const std::vector<blockchain::Transaction> &transactions, std::vector<chat::TxCode> &codes) {
+    ChatClient client(connections_.get(), leader_);
+    codes.clear();
+    if (!client.NewTxBatch(transactions, &codes)) {
+        return 0;
+    }
+
+    return std::count(codes.begin(), codes.end(), chat::TX_ACCEPTED);
+}
+
 int WalletClientImpl::SendSyncRequest(const uint32_t wallet_id, blockchain::UTXOlist &utxolist) {
-    ChatClient chat(grpc::CreateChannel(leader_, grpc::InsecureChannelCredentials()));
+    ChatClient chat(connections_.get(), leader_);
     chat.Sync(wallet_id, &utxolist);
 
     return 1;
 }
 
-WalletClientImpl::WalletClientImpl(config::Settings settings) {
+WalletClientImpl::WalletClientImpl(config::Settings settings) : connections_(std::make_shared<ConnectionManager>(settings)) {
     // Read leader addres from file
     leader_ = settings.getLeaderAddress();
 }
 
 // -------------------------------- ValidatorClientImpl --------------------------------
 
-int ValidatorClientImpl::SendMessage_(const blockchain::Message message, const std::string server_address) {
-    std::cout << "Client:: SendMessage_ to " << server_address << std::endl;
-    ChatClient chat(grpc::CreateChannel(server_address, grpc::InsecureChannelCredentials()));
-    chat.Talk(message);
-
-    return 1;
-}
-
 int ValidatorClientImpl::Broadcast(const blockchain::Message message) {
-    // Lock queues
-    {
-        std::lock_guard<std::mutex> cv_lock(mq_mtx_);
-        // Add message to every que
-        for (int i = 0; i < servers_.size(); ++i) {
-            message_queues_[servers_[i]]->push(message);
-        }
+    // Serialize once, every queue shares the same bytes
+    EncodedMessage encoded(message);
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        Enqueue_(*peers_[servers_[i]], encoded);
     }
-    // Notify threads a new message is added & release lock
-    mq_cv_.notify_all();
 
     // std::cout << "Broadcast Successfully!" << std::endl;
 
@@ -94,65 +137,250 @@ int ValidatorClientImpl::Broadcast(const blockchain::Message message) {
 }
 
 int ValidatorClientImpl::SendToLeader(const blockchain::Message message) {
-    // this->SendMessage_(message, leader_);
-    mq_mtx_.lock();
-    message_queues_[leader_]->push(message);
-    mq_mtx_.unlock();
-    mq_cv_.notify_all();
+    auto it = peers_.find(leader_);
+    if (it == peers_.end()) {
+        return 0;
+    }
+    Enqueue_(*it->second, EncodedMessage(message));
 
     return 1;
 }
 
-void ValidatorClientImpl::RunThread_(const std::string server_address, std::shared_ptr<std::queue<blockchain::Message>> mq) {
-    st_mtx_.lock();
-    while (!stop_threads_) {
-        st_mtx_.unlock();
+int ValidatorClientImpl::Send(const blockchain::Message message, uint16_t validator_id) {
+    if (validators_.find(validator_id) == validators_.end()) {
+        return 0;
+    }
+    auto it = peers_.find(validators_[validator_id]);
+    if (it == peers_.end()) {
+        return 0;
+    }
+    Enqueue_(*it->second, EncodedMessage(message));
+
+    return 1;
+}
+
+bool ValidatorClientImpl::FetchBlock(const std::string &block_hash, uint16_t validator_id, blockchain::Block &block) {
+    if (validators_.find(validator_id) == validators_.end()) {
+        return false;
+    }
+    ChatClient chat(connections_.get(), validators_[validator_id]);
+    return chat.FetchBlock(block_hash, &block);
+}
+
+std::map<std::string, size_t> ValidatorClientImpl::getQueueDepths() {
+    std::map<std::string, size_t> depths;
+    for (const auto &peer : peers_) {
+        depths[peer.first] = peer.second->depth;
+    }
+    return depths;
+}
+
+std::map<std::string, uint64_t> ValidatorClientImpl::getDroppedMessages() {
+    std::map<std::string, uint64_t> dropped;
+    for (const auto &peer : peers_) {
+        dropped[peer.first] = peer.second->dropped;
+    }
+    return dropped;
+}
 
-        // Wait for new message in queue
-        std::unique_lock<std::mutex> cv_lock(mq_mtx_);
-        mq_cv_.wait(cv_lock, [&mq, this] { return !mq->empty() || stop_threads_; });
+void ValidatorClientImpl::Enqueue_(Peer &peer, const EncodedMessage &message) {
+    // Counted first, the sender thread may ack the message before push() returns
+    peer.depth++;
+    EncodedMessage copy(message);
+    bool queued;
+    if (!peer.lagging) {
+        // A slow peer pushes back on the broadcast for a while
+        queued = peer.queue.pushWait(std::move(copy), running_, std::chrono::milliseconds(PEER_QUEUE_WAIT_MS_));
+    } else {
+        // The peer already fell out of sync, it doesn't hold up every broadcast again
+        queued = peer.queue.push(std::move(copy));
+    }
+    if (!queued) {
+        // Later messages of this node can't be verified by the peer anymore, it has to catch up like a faulty node
+        peer.depth--;
+        peer.dropped++;
+        peer.lagging = true;
+        return;
+    }
 
-        if (!mq->empty()) {
-            // Get & delete message from queue
-            blockchain::Message msg = mq->front();
-            mq->pop();
-            mq_mtx_.unlock();
+    Wake_(peer);
+}
 
-            // Send message
-            SendMessage_(msg, server_address);
+void ValidatorClientImpl::Wake_(Peer &peer) {
+    // One pending alarm wakes the sender for everything queued before it fires
+    if (!peer.wake_pending.exchange(true)) {
+        std::lock_guard<std::mutex> lock(peer.wake_mtx);
+        if (!peer.closed) {
+            peer.alarm.Set(&peer.cq, gpr_now(GPR_CLOCK_MONOTONIC), tag_(WAKE));
         }
+    }
+}
+
+void ValidatorClientImpl::OpenStream_(Peer &peer) {
+    peer.context.reset(new ClientContext());
+    peer.stream = connections_->getGenericStub(peer.address)->PrepareCall(peer.context.get(), STREAM_METHOD_, &peer.cq);
+    peer.stream->StartCall(tag_(STARTED));
+    peer.failed = false;
+    peer.written = 0;
+    peer.batches = std::queue<size_t>();
+}
+
+void ValidatorClientImpl::WriteBatch_(Peer &peer) {
+    // The batch is framed around the encoded messages, nothing is serialized again
+    std::vector<grpc::Slice> slices;
+    size_t count = 0;
+    while (peer.written < peer.unacked.size() && count < STREAM_BATCH_) {
+        const auto &pending = peer.unacked[peer.written++];
+        pending.second.appendSend(session_, pending.first, slices);
+        count++;
+    }
+    peer.batches.push(count);
+    peer.writing = true;
+    peer.stream->Write(grpc::ByteBuffer(slices.data(), slices.size()), tag_(WRITTEN));
+}
 
-        st_mtx_.lock();
+void ValidatorClientImpl::FailStream_(Peer &peer) {
+    if (!peer.failed) {
+        peer.failed = true;
+        peer.open = false;
+        // Completes the outstanding write & read right away
+        peer.context->TryCancel();
     }
-    st_mtx_.unlock();
 }
 
-ValidatorClientImpl::ValidatorClientImpl(config::Settings settings) {
+void ValidatorClientImpl::RunThread_(std::shared_ptr<Peer> peer) {
+    void *tag;
+    bool ok;
+    std::vector<EncodedMessage> messages;
+
+    while (running_) {
+        // Fill the window, messages keep their seq if they have to be resent on a new stream
+        if (peer->unacked.size() < send_window_) {
+            messages.clear();
+            peer->queue.popAll(messages, send_window_ - peer->unacked.size());
+            for (EncodedMessage &message : messages) {
+                peer->unacked.emplace_back(peer->next_seq++, std::move(message));
+            }
+        }
+        // A peer that caught up holds up the broadcasts again instead of missing messages
+        if (peer->lagging && peer->depth <= PEER_CATCH_UP_DEPTH_) {
+            peer->lagging = false;
+        }
+
+        if (!peer->stream && !peer->backoff && !peer->unacked.empty()) {
+            OpenStream_(*peer);
+        }
+        // gRPC allows one outstanding write per stream, everything queued meanwhile goes into the next batch
+        if (peer->open && !peer->writing && peer->written < peer->unacked.size()) {
+            WriteBatch_(*peer);
+        }
+        // A broken stream is finished once its last operation completed, the status tells why it broke
+        if (peer->failed && !peer->writing && !peer->reading) {
+            peer->failed = false;
+            peer->stream->Finish(&peer->status, tag_(FINISHED));
+        }
+
+        // Wait for a stream event or a new message
+        if (!peer->cq.Next(&tag, &ok)) {
+            break;
+        }
+        switch (static_cast<Event>(reinterpret_cast<intptr_t>(tag))) {
+            case WAKE:
+                peer->wake_pending = false;
+                break;
+            case STARTED:
+                if (!ok) {
+                    FailStream_(*peer);
+                    break;
+                }
+                peer->open = true;
+                peer->reading = true;
+                peer->stream->Read(&peer->ack, tag_(ACKED));
+                break;
+            case WRITTEN:
+                peer->writing = false;
+                if (!ok) {
+                    FailStream_(*peer);
+                }
+                break;
+            case ACKED:
+                peer->reading = false;
+                if (!ok || peer->batches.empty()) {
+                    FailStream_(*peer);
+                    break;
+                }
+                // The oldest batch is queued at the peer, free its part of the window
+                peer->unacked.erase(peer->unacked.begin(), peer->unacked.begin() + peer->batches.front());
+                peer->written -= peer->batches.front();
+                peer->depth -= peer->batches.front();
+                peer->batches.pop();
+                connections_->recordResult(peer->address, Status::OK);
+                peer->reading = true;
+                peer->stream->Read(&peer->ack, tag_(ACKED));
+                break;
+            case FINISHED:
+                connections_->recordResult(peer->address, peer->status);
+                std::cout << "Client:: stream to " << peer->address << " closed: " << peer->status.error_message() << std::endl;
+                peer->stream.reset();
+                peer->context.reset();
+                peer->backoff = true;
+                peer->retry_alarm.Set(&peer->cq, std::chrono::system_clock::now() + std::chrono::milliseconds(STREAM_RETRY_MS_), tag_(RETRY));
+                break;
+            case RETRY:
+                peer->backoff = false;
+                break;
+        }
+    }
+
+    // Stop waking up this thread, then drain the outstanding stream operations
+    if (peer->stream) {
+        peer->context->TryCancel();
+    }
+    peer->wake_mtx.lock();
+    peer->closed = true;
+    peer->wake_mtx.unlock();
+    peer->alarm.Cancel();
+    peer->retry_alarm.Cancel();
+    peer->cq.Shutdown();
+    while (peer->cq.Next(&tag, &ok)) {
+    }
+    peer->stream.reset();
+    peer->context.reset();
+}
+ValidatorClientImpl::ValidatorClientImpl(config::Settings settings) : connections_(std::make_shared<ConnectionManager>(settings)) {
     // Read server addresses from file
     servers_ = settings.getValidatorAdresses();
     leader_ = settings.getLeaderAddress();
+    for (const config::AddressInfo &info : settings.getValidators()) {
+        validators_[info.id] = info.address + ":" + std::to_string(info.port);
+    }
+    send_window_ = std::max<uint32_t>(1, settings.getSendWindow());
 
     startThreads_();
 }
 
 void ValidatorClientImpl::startThreads_() {
-    uint8_t num_servers = servers_.size();
-    stop_threads_ = false;
+    size_t num_servers = servers_.size();
+    // Every client instance numbers its messages in a session of its own
+    std::random_device rd;
+    session_ = (static_cast<uint64_t>(rd()) << 32) | rd();
 
     // Start RunThread with different server & queue
-    for (int i = 0; i < num_servers; ++i) {
-        std::shared_ptr<std::queue<blockchain::Message>> thread_queue = std::make_shared<std::queue<blockchain::Message>>();
-        message_queues_[servers_[i]] = thread_queue;
-        thread_pool_.push_back(std::thread([&, i, thread_queue]() { RunThread_(servers_[i], thread_queue); }));
+    for (size_t i = 0; i < num_servers; ++i) {
+        std::shared_ptr<Peer> peer = std::make_shared<Peer>();
+        peer->address = servers_[i];
+        peers_[servers_[i]] = peer;
+        thread_pool_.push_back(std::thread([this, peer]() { RunThread_(peer); }));
     }
 }
 
 ValidatorClientImpl::~ValidatorClientImpl() {
-    st_mtx_.lock();
-    stop_threads_ = true;
-    st_mtx_.unlock();
-    mq_cv_.notify_all();
-    for (int i = 0; i < thread_pool_.size(); ++i) {
+    running_ = false;
+    for (auto &peer : peers_) {
+        peer.second->queue.wakeProducers();
+        Wake_(*peer.second);
+    }
+    for (size_t i = 0; i < thread_pool_.size(); ++i) {
         thread_pool_[i].join();
     }
 }
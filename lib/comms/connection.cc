@@ -0,0 +1,87 @@
+#include "comms/connection.h"
+
+using namespace comms;
+
+ConnectionManager::ConnectionManager(config::Settings settings) {
+    keepalive_time_ms_ = settings.getKeepaliveTimeMs();
+    keepalive_timeout_ms_ = settings.getKeepaliveTimeoutMs();
+    reconnect_backoff_min_ms_ = settings.getReconnectBackoffMinMs();
+    reconnect_backoff_max_ms_ = settings.getReconnectBackoffMaxMs();
+}
+
+grpc::ChannelArguments ConnectionManager::channelArguments_() const {
+    grpc::ChannelArguments args;
+    // Keeps idle channels open, consensus rounds can be seconds apart
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_time_ms_);
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepalive_timeout_ms_);
+    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+    // Retries a crashed or not yet started peer quickly, without hammering it
+    args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, reconnect_backoff_min_ms_);
+    args.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, reconnect_backoff_min_ms_);
+    args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, reconnect_backoff_max_ms_);
+    return args;
+}
+
+ConnectionManager::Connection& ConnectionManager::connection_(const std::string& address) {
+    auto it = connections_.find(address);
+    if (it != connections_.end()) {
+        return it->second;
+    }
+
+    Connection& connection = connections_[address];
+    connection.channel = grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), channelArguments_());
+    connection.stub = std::shared_ptr<chat::Chat::Stub>(chat::Chat::NewStub(connection.channel));
+    connection.generic_stub = std::make_shared<grpc::GenericStub>(connection.channel);
+    return connection;
+}
+
+std::shared_ptr<chat::Chat::Stub> ConnectionManager::getStub(const std::string& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_(address).stub;
+}
+
+std::shared_ptr<grpc::GenericStub> ConnectionManager::getGenericStub(const std::string& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_(address).generic_stub;
+}
+
+void ConnectionManager::recordResult(const std::string& address, const grpc::Status& status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = connections_.find(address);
+    if (it == connections_.end()) {
+        return;
+    }
+    it->second.rpcs++;
+    if (!status.ok()) {
+        it->second.failures++;
+    }
+}
+
+grpc_connectivity_state ConnectionManager::getState(const std::string& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = connections_.find(address);
+    if (it == connections_.end()) {
+        return GRPC_CHANNEL_SHUTDOWN;
+    }
+    return it->second.channel->GetState(false);
+}
+
+std::vector<ChannelMetrics> ConnectionManager::getMetrics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ChannelMetrics> metrics;
+    for (const auto& entry : connections_) {
+        ChannelMetrics m;
+        m.address = entry.first;
+        m.state = entry.second.channel->GetState(false);
+        m.rpcs = entry.second.rpcs;
+        m.failures = entry.second.failures;
+        metrics.push_back(m);
+    }
+    return metrics;
+}
+
+size_t ConnectionManager::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size();
+}
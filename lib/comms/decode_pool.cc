@@ -0,0 +1,62 @@
+#include "comms/decode_pool.h"
+
+#include <algorithm>
+
+using namespace comms;
+
+DecodePool::DecodePool(uint32_t num_threads) {
+    num_threads = std::max<uint32_t>(1, num_threads);
+    for (uint32_t i = 0; i < num_threads; i++) {
+        lanes_.push_back(std::unique_ptr<MPSCQueue<Task>>(new MPSCQueue<Task>(DECODE_LANE_CAPACITY_)));
+    }
+    for (uint32_t i = 0; i < num_threads; i++) {
+        threads_.push_back(std::thread([this, i]() { RunLane_(i); }));
+    }
+}
+
+DecodePool::~DecodePool() {
+    Stop();
+}
+
+void DecodePool::Submit(uint64_t key, Task task) {
+    MPSCQueue<Task>& lane = *lanes_[key % lanes_.size()];
+    // A full lane pushes back on the caller, running the task here could overtake queued tasks of the same key
+    if (running_ && lane.pushWait(std::move(task), running_)) {
+        return;
+    }
+    task();
+}
+
+void DecodePool::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& lane : lanes_) {
+        lane->wake();
+        lane->wakeProducers();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void DecodePool::RunLane_(uint32_t lane) {
+    MPSCQueue<Task>& queue = *lanes_[lane];
+    std::vector<Task> tasks;
+    while (true) {
+        bool running = running_;
+        // Stop() sets the flag before the wakeup, so only sleep while the flag was still set
+        if (running) {
+            queue.wait();
+        }
+        queue.popAll(tasks);
+        for (Task& task : tasks) {
+            task();
+        }
+        tasks.clear();
+        // Drains the lane once more after the stop flag was seen
+        if (!running) {
+            break;
+        }
+    }
+}
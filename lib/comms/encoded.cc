@@ -0,0 +1,45 @@
+#include "comms/encoded.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using namespace comms;
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
+
+EncodedMessage::EncodedMessage(const blockchain::Message& message) : EncodedMessage(message.toProtoMessage()) {}
+
+EncodedMessage::EncodedMessage(const chat::Message& message) : slice_(message.SerializeAsString()) {}
+
+void EncodedMessage::appendSend(uint64_t session, uint64_t seq, std::vector<grpc::Slice>& slices) const {
+    const uint32_t sends_tag = WireFormatLite::MakeTag(chat::SendBatch::kSendsFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    const uint32_t message_tag = WireFormatLite::MakeTag(chat::Send::kMessageFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+    // Fields after the message: session & seq
+    std::string trailer;
+    {
+        StringOutputStream stream(&trailer);
+        CodedOutputStream out(&stream);
+        WireFormatLite::WriteUInt64(chat::Send::kSessionFieldNumber, session, &out);
+        WireFormatLite::WriteUInt64(chat::Send::kSeqFieldNumber, seq, &out);
+    }
+
+    // Length prefix of the Send entry & of its message field
+    size_t send_size = CodedOutputStream::VarintSize32(message_tag) + CodedOutputStream::VarintSize64(slice_.size()) + slice_.size() + trailer.size();
+    std::string header;
+    {
+        StringOutputStream stream(&header);
+        CodedOutputStream out(&stream);
+        out.WriteTag(sends_tag);
+        out.WriteVarint64(send_size);
+        out.WriteTag(message_tag);
+        out.WriteVarint64(slice_.size());
+    }
+
+    slices.emplace_back(header);
+    slices.push_back(slice_);
+    slices.emplace_back(trailer);
+}
@@ -0,0 +1,54 @@
+#include "comms/rate_limiter.h"
+
+#include <algorithm>
+
+using namespace comms;
+
+size_t RateLimiter::acquire(uint64_t sender, size_t count, std::chrono::steady_clock::time_point now) {
+    if (!enabled()) {
+        return count;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = buckets_.find(sender);
+    if (it == buckets_.end()) {
+        if (buckets_.size() >= RATE_LIMIT_SENDERS_) {
+            prune_(now);
+        }
+        it = buckets_.emplace(sender, Bucket{static_cast<double>(burst_), now}).first;
+    }
+
+    Bucket& bucket = it->second;
+    std::chrono::duration<double> elapsed = now - bucket.last;
+    bucket.tokens = std::min<double>(burst_, bucket.tokens + elapsed.count() * rate_);
+    bucket.last = now;
+
+    size_t taken = std::min<size_t>(count, static_cast<size_t>(bucket.tokens));
+    bucket.tokens -= taken;
+    limited_ += count - taken;
+    return taken;
+}
+
+void RateLimiter::release(uint64_t sender, size_t count) {
+    if (!enabled() || count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A forgotten sender had a full bucket
+    auto it = buckets_.find(sender);
+    if (it != buckets_.end()) {
+        it->second.tokens = std::min<double>(burst_, it->second.tokens + count);
+    }
+}
+
+void RateLimiter::prune_(std::chrono::steady_clock::time_point now) {
+    for (auto it = buckets_.begin(); it != buckets_.end();) {
+        std::chrono::duration<double> elapsed = now - it->second.last;
+        if (it->second.tokens + elapsed.count() * rate_ >= burst_) {
+            it = buckets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#include "comms/reorder.h"
+
+using namespace comms;
+
+bool ReorderBuffer::add(uint64_t sender, uint64_t session, uint64_t seq, blockchain::Message&& message, const std::function<bool(blockchain::Message&&)>& deliver) {
+    if (seq == 0) {
+        return deliver(std::move(message));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Session& s = sessions_[sender];
+    if (s.id != session) {
+        // The sender started over, the messages held back for its previous session won't be completed anymore
+        s.id = session;
+        s.next = seq;
+        s.waiting.clear();
+    }
+    if (seq >= s.next) {
+        // No-op for a duplicate that is still held back
+        s.waiting.emplace(seq, std::move(message));
+        // A message that never arrives (e.g. a failed call) can't hold back the session forever
+        if (s.waiting.size() > REORDER_LIMIT_ && s.waiting.begin()->first > s.next) {
+            s.next = s.waiting.begin()->first;
+        }
+    }
+
+    // The seq is used up only once its message was handed over, a refused message stays first in line
+    auto it = s.waiting.begin();
+    while (it != s.waiting.end() && it->first == s.next) {
+        if (!deliver(std::move(it->second))) {
+            return false;
+        }
+        it = s.waiting.erase(it);
+        s.next++;
+    }
+    return true;
+}
+
+void ReorderBuffer::add(uint64_t sender, uint64_t session, uint64_t seq, blockchain::Message&& message, std::vector<blockchain::Message>& ready) {
+    add(sender, session, seq, std::move(message), [&ready](blockchain::Message&& msg) {
+        ready.push_back(std::move(msg));
+        return true;
+    });
+}
+
+size_t ReorderBuffer::pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& s : sessions_) {
+        count += s.second.waiting.size();
+    }
+    return count;
+}
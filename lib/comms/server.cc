@@ -4,44 +4,53 @@ using namespace comms;
 
 ChatServiceImpl::~ChatServiceImpl() {  // destructor, this is executed when the object gets out of scope
     is_running_ = false;
-    server_->Shutdown();
-    cq_->Shutdown();
+    if (!server_) {
+        return;
+    }
+    // The streams of the peers stay open as long as their clients live, don't wait for them
+    server_->Shutdown(std::chrono::system_clock::now() + std::chrono::milliseconds(SHUTDOWN_GRACE_MS_));
+    // Queued decode tasks still answer their calls before the completion queues close
+    decoder_->Stop();
+    for (auto &cq : cqs_) {
+        cq->Shutdown();
+    }
+    // Wait until Run() drained the queues & joined the polling threads
+    std::lock_guard<std::mutex> lock(run_mutex_);
 }
 
 void ChatServiceImpl::Run(uint16_t port) {  // configures the server to listen on a specified port and starts the server.
+    std::lock_guard<std::mutex> lock(run_mutex_);
     std::string server_address = "0.0.0.0:" + std::to_string(port);
 
     ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     builder.RegisterService(&service_);
 
-    cq_ = builder.AddCompletionQueue();
+    for (uint32_t i = 0; i < num_threads_; i++) {
+        cqs_.push_back(builder.AddCompletionQueue());
+    }
     server_ = builder.BuildAndStart();
+    decoder_.reset(new DecodePool(num_threads_));
     io_mutex_.lock();
-    std::cout << "Server listening on " << server_address << std::endl;
+    std::cout << "Server listening on " << server_address << " with " << num_threads_ << " threads" << std::endl;
     io_mutex_.unlock();
 
     is_running_ = true;
-    HandleRpcs();
+    for (uint32_t i = 1; i < num_threads_; i++) {
+        cq_threads_.push_back(std::thread(&ChatServiceImpl::HandleRpcs, this, cqs_[i].get()));
+    }
+    HandleRpcs(cqs_[0].get());
+    for (auto &thread : cq_threads_) {
+        thread.join();
+    }
+    cq_threads_.clear();
 }
 
 bool ChatServiceImpl::getMessages(std::vector<blockchain::Message> &msg_list) {
-    mq_mutex_.lock();
-    if (mq_.empty()) {
-        mq_mutex_.unlock();
-        return false;
-    } else {
-        while (!mq_.empty()) {
-            msg_list.push_back(mq_.front());
-            mq_.pop();
-        }
-        mq_mutex_.unlock();
-        return true;
-    }
+    return mq_.popAll(msg_list);
 }
 
 bool ChatServiceImpl::newConsensusMessages() {
-    std::lock_guard<std::mutex> lock_m(mq_mutex_);
     return !mq_.empty();
 }
 
@@ -49,23 +58,11 @@ bool ChatServiceImpl::newRequests() {
     /*io_mutex_.lock();
     std::cout << "Server.cc:" << "newRequests in " << std::endl;
     io_mutex_.unlock();*/
-    std::lock_guard<std::mutex> lock_tx(txq_mutex_);
     return !txq_.empty();
 }
 
 bool ChatServiceImpl::getTransactions(std::vector<blockchain::Transaction> &tx_list) {
-    txq_mutex_.lock();
-    if (txq_.empty()) {
-        txq_mutex_.unlock();
-        return false;
-    } else {
-        while (!txq_.empty()) {
-            tx_list.push_back(txq_.front());
-            txq_.pop();
-        }
-        txq_mutex_.unlock();
-        return true;
-    }
+    return txq_.popAll(tx_list);
 }
 
 void ChatServiceImpl::setUTXOlists(std::unordered_map<uint32_t, blockchain::UTXOlist> utxolists) {
@@ -76,9 +73,9 @@ void ChatServiceImpl::setUTXOlists(std::unordered_map<uint32_t, blockchain::UTXO
 }
 
 // One Calldata object handling each request thread
-ChatServiceImpl::CallDataTalk::CallDataTalk(Chat::AsyncService *service, ServerCompletionQueue *cq, std::queue<blockchain::Message> *mq,
-                                            std::mutex *io_mutex, std::mutex *mq_mutex, std::condition_variable *cv)
-    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_mq_mutex_(mq_mutex), cd_mq_(mq), cd_cv_(cv) {
+ChatServiceImpl::CallDataTalk::CallDataTalk(Chat::AsyncService *service, ServerCompletionQueue *cq, MPSCQueue<blockchain::Message> *mq,
+                                            DecodePool *decoder, ReorderBuffer *reorder, KnownBlockFilter *filter, std::mutex *filter_mutex, std::atomic<uint64_t> *refused, std::mutex *io_mutex)
+    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_mq_(mq), cd_decoder_(decoder), cd_reorder_(reorder), cd_filter_(filter), cd_filter_mutex_(filter_mutex), cd_refused_(refused) {
     Proceed();
 }
 
@@ -90,39 +87,101 @@ void ChatServiceImpl::CallDataTalk::Proceed() {
                                  this);
         // std::cout << "CREATE" << std::endl;
     } else if (status_ == START_PROCESS) {
-        new CallDataTalk(cd_service_, cd_cq_, cd_mq_, cd_io_mutex_, cd_mq_mutex_, cd_cv_);
+        new CallDataTalk(cd_service_, cd_cq_, cd_mq_, cd_decoder_, cd_reorder_, cd_filter_, cd_filter_mutex_, cd_refused_, cd_io_mutex_);
 
-        // The actual processing.
-        blockchain::Message message_(request_.message());
-
-        cd_io_mutex_->lock();
-        std::cout << "Server: received message from " << message_.getSenderId() << std::endl;
-        cd_io_mutex_->unlock();
+        // The actual processing, off the completion queue thread.
+        // Messages of one sender share a decode thread, so their signing keys stay in order
+        cd_decoder_->Submit(request_.message().sender_id(), [this]() { Decode(); });
+    } else {
+        GPR_ASSERT(status_ == FINISH);
+        delete this;
+    }
+}
 
-        cd_mq_mutex_->lock();
-        cd_mq_->push(message_);
-        cd_mq_mutex_->unlock();
+void ChatServiceImpl::CallDataTalk::Decode() {
+    // Pipelined messages of a sender can overtake each other, release them in send order.
+    // Wakes up the consensus thread only, a full ring pushes back on the sender
+    Status status = Status::OK;
+    auto push = [this](blockchain::Message &&message) { return cd_mq_->push(std::move(message)); };
+    if (!cd_reorder_->add(request_.message().sender_id(), request_.session(), request_.seq(), decodeMessage_(request_.message(), cd_filter_, cd_filter_mutex_), push)) {
+        // The message is held back, not dropped: a retry hands it over once the consensus thread caught up
+        (*cd_refused_)++;
+        status = Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "consensus queue full");
+    }
 
-        // Notify cv
-        if (cd_cv_ != nullptr) {
-            cd_cv_->notify_all();
-        }
+    // Send ack reply, the completion can be handled by another thread right away
+    status_ = FINISH;
+    responder_.Finish(reply_, status, this);
+}
 
-        // Send ack reply
-        responder_.Finish(reply_, Status::OK, this);
-        status_ = FINISH;
+// One Calldata object handling each stream of a peer
+ChatServiceImpl::CallDataStream::CallDataStream(Chat::AsyncService *service, ServerCompletionQueue *cq, MPSCQueue<blockchain::Message> *mq,
+                                                DecodePool *decoder, ReorderBuffer *reorder, KnownBlockFilter *filter, std::mutex *filter_mutex,
+                                                std::atomic<bool> *is_running, std::atomic<uint64_t> *refused, std::mutex *io_mutex)
+    : CallData(service, cq), stream_(&ctx_), cd_io_mutex_(io_mutex), cd_mq_(mq), cd_decoder_(decoder), cd_reorder_(reorder), cd_filter_(filter), cd_filter_mutex_(filter_mutex), cd_is_running_(is_running), cd_refused_(refused) {
+    Proceed();
+}
 
-        // std::cout << "FINISH" << std::endl;
+// A stream has one read or one write outstanding at a time, so batches of a peer are handled in order
+void ChatServiceImpl::CallDataStream::Proceed() {
+    if (status_ == CREATE) {
+        status_ = START_PROCESS;
+        cd_service_->RequestStream(&ctx_, &stream_, cd_cq_, cd_cq_, this);
+    } else if (status_ == START_PROCESS) {
+        new CallDataStream(cd_service_, cd_cq_, cd_mq_, cd_decoder_, cd_reorder_, cd_filter_, cd_filter_mutex_, cd_is_running_, cd_refused_, cd_io_mutex_);
+
+        status_ = READ;
+        stream_.Read(&batch_, this);
+    } else if (status_ == READ) {
+        // A batch holds messages of one sender, keep it on the decode thread of that sender
+        uint64_t sender_id = batch_.sends_size() > 0 ? batch_.sends(0).message().sender_id() : 0;
+        cd_decoder_->Submit(sender_id, [this]() { Decode(); });
+    } else if (status_ == WRITE) {
+        status_ = READ;
+        stream_.Read(&batch_, this);
     } else {
         GPR_ASSERT(status_ == FINISH);
         delete this;
     }
 }
 
+void ChatServiceImpl::CallDataStream::Abort() {
+    if ((status_ == READ || status_ == WRITE) && *cd_is_running_) {
+        // The peer closed its side or the stream broke, a new stream of the peer resends unacked batches
+        status_ = FINISH;
+        stream_.Finish(Status::OK, this);
+        return;
+    }
+    delete this;
+}
+
+void ChatServiceImpl::CallDataStream::Decode() {
+    // Same path as a Talk message, resent messages are dropped as duplicates by the reorder buffer
+    auto push = [this](blockchain::Message &&message) { return cd_mq_->push(std::move(message)); };
+    uint64_t refused = 0;
+    for (const chat::Send &send : batch_.sends()) {
+        if (!cd_reorder_->add(send.message().sender_id(), send.session(), send.seq(), decodeMessage_(send.message(), cd_filter_, cd_filter_mutex_), push)) {
+            refused++;
+        }
+    }
+
+    if (refused > 0) {
+        // No ack: the peer resends its unacked batches on a new stream, the resent duplicates hand over what was held back
+        *cd_refused_ += refused;
+        status_ = FINISH;
+        stream_.Finish(Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "consensus queue full"), this);
+        return;
+    }
+
+    // The ack opens the send window of the peer again, that way a slow consensus thread slows down its peers
+    status_ = WRITE;
+    stream_.Write(reply_, this);
+}
+
 // One Calldata object handling each request thread
-ChatServiceImpl::CallDataNewTx::CallDataNewTx(Chat::AsyncService *service, ServerCompletionQueue *cq, std::queue<blockchain::Transaction> *txq,
-                                              std::mutex *io_mutex, std::mutex *txq_mutex, std::condition_variable *cv)
-    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_txq_mutex_(txq_mutex), cd_txq_(txq), cd_cv_(cv) {
+ChatServiceImpl::CallDataNewTx::CallDataNewTx(Chat::AsyncService *service, ServerCompletionQueue *cq, MPSCQueue<blockchain::Transaction> *txq,
+                                              DecodePool *decoder, RateLimiter *limiter, std::atomic<uint64_t> *rejected, std::mutex *io_mutex)
+    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_txq_(txq), cd_decoder_(decoder), cd_limiter_(limiter), cd_rejected_(rejected) {
     Proceed();
 }
 
@@ -134,36 +193,117 @@ void ChatServiceImpl::CallDataNewTx::Proceed() {
                                   this);
         // std::cout << "CREATE" << std::endl;
     } else if (status_ == START_PROCESS) {
-        new CallDataNewTx(cd_service_, cd_cq_, cd_txq_, cd_io_mutex_, cd_txq_mutex_, cd_cv_);
+        new CallDataNewTx(cd_service_, cd_cq_, cd_txq_, cd_decoder_, cd_limiter_, cd_rejected_, cd_io_mutex_);
 
-        // The actual processing.
-        blockchain::Transaction transaction_;
-        transaction_.fromProtoTransaction(request_.transaction());
+        // The actual processing, off the completion queue thread.
+        // Transactions of one wallet share a decode thread, so their signing keys stay in order
+        cd_decoder_->Submit(request_.transaction().senderid(), [this]() { Decode(); });
+    } else {
+        GPR_ASSERT(status_ == FINISH);
+        delete this;
+    }
+}
 
-        cd_io_mutex_->lock();
-        std::cout << "Server: received new transaction from " << transaction_.getSenderID() << std::endl;
-        cd_io_mutex_->unlock();
+void ChatServiceImpl::CallDataNewTx::Decode() {
+    // A client over its rate is turned away before its transaction is decoded
+    Status status = Status::OK;
+    if (cd_limiter_->acquire(limiterKey_(ctx_.peer())) == 0) {
+        status = Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "rate limit exceeded");
+        status_ = FINISH;
+        responder_.Finish(reply_, status, this);
+        return;
+    }
 
-        cd_txq_mutex_->lock();
-        cd_txq_->push(transaction_);
-        cd_txq_mutex_->unlock();
+    blockchain::Transaction transaction_;
+    transaction_.fromProtoTransaction(request_.transaction());
 
-        // Notify cv
-        if (cd_cv_ != nullptr) {
-            cd_cv_->notify_all();
-        }
+    // Wakes up the tx ingest thread only, a full ring pushes back on the wallet
+    if (!cd_txq_->push(std::move(transaction_))) {
+        // The rejected transaction doesn't count against the rate of the client
+        cd_limiter_->release(limiterKey_(ctx_.peer()), 1);
+        (*cd_rejected_)++;
+        status = Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "transaction queue full");
+    }
 
-        // Send ack reply
-        responder_.Finish(reply_, Status::OK, this);
-        status_ = FINISH;
+    // Send ack reply, the completion can be handled by another thread right away
+    status_ = FINISH;
+    responder_.Finish(reply_, status, this);
+}
 
-        // std::cout << "FINISH" << std::endl;
+// One Calldata object handling each request thread
+ChatServiceImpl::CallDataNewTxBatch::CallDataNewTxBatch(Chat::AsyncService *service, ServerCompletionQueue *cq, MPSCQueue<blockchain::Transaction> *txq,
+                                                        DecodePool *decoder, RateLimiter *limiter, std::atomic<uint64_t> *rejected, std::mutex *io_mutex)
+    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_txq_(txq), cd_decoder_(decoder), cd_limiter_(limiter), cd_rejected_(rejected) {
+    Proceed();
+}
+
+void ChatServiceImpl::CallDataNewTxBatch::Proceed() {
+    if (status_ == CREATE) {
+        status_ = START_PROCESS;
+        cd_service_->RequestNewTxBatch(&ctx_, &request_, &responder_, cd_cq_, cd_cq_, this);
+    } else if (status_ == START_PROCESS) {
+        new CallDataNewTxBatch(cd_service_, cd_cq_, cd_txq_, cd_decoder_, cd_limiter_, cd_rejected_, cd_io_mutex_);
+
+        // The transactions beyond the rate of the client are rejected, the others are decoded
+        std::map<uint64_t, std::vector<int>> senders;  // map<sender, index in the batch>
+        size_t allowed = cd_limiter_->acquire(limiterKey_(ctx_.peer()), request_.transactions_size());
+        for (int i = 0; i < request_.transactions_size(); i++) {
+            reply_.add_codes(chat::TX_RATE_LIMITED);
+            if (static_cast<size_t>(i) < allowed) {
+                senders[request_.transactions(i).senderid()].push_back(i);
+            }
+        }
+        for (auto &sender : senders) {
+            parts_.push_back(std::move(sender.second));
+        }
+
+        // Transactions of one wallet share a decode thread, so their signing keys stay in order
+        // The call can't finish before every part is submitted, a stopped pool runs the parts right here
+        pending_ = parts_.size() + 1;
+        for (size_t p = 0; p < parts_.size(); p++) {
+            cd_decoder_->Submit(request_.transactions(parts_[p].front()).senderid(), [this, p]() { Decode(parts_[p]); });
+        }
+        Done_();
     } else {
         GPR_ASSERT(status_ == FINISH);
         delete this;
     }
 }
 
+void ChatServiceImpl::CallDataNewTxBatch::Decode(const std::vector<int> &part) {
+    std::vector<blockchain::Transaction> transactions(part.size());
+    for (size_t i = 0; i < part.size(); i++) {
+        transactions[i].fromProtoTransaction(request_.transactions(part[i]));
+    }
+
+    // One claim on the ring for the part, whatever doesn't fit is rejected
+    // The codes are preallocated, the parts set disjoint entries
+    size_t queued = cd_txq_->pushAll(transactions);
+    for (size_t i = 0; i < part.size(); i++) {
+        reply_.set_codes(part[i], i < queued ? chat::TX_ACCEPTED : chat::TX_QUEUE_FULL);
+    }
+    dropped_ += part.size() - queued;
+
+    Done_();
+}
+
+void ChatServiceImpl::CallDataNewTxBatch::Done_() {
+    if (pending_.fetch_sub(1) != 1) {
+        return;
+    }
+
+    size_t dropped = dropped_;
+    if (dropped > 0) {
+        // The rejected transactions don't count against the rate of the client
+        cd_limiter_->release(limiterKey_(ctx_.peer()), dropped);
+        *cd_rejected_ += dropped;
+    }
+
+    // The batch was handled, the codes tell the wallet what to retry; an error status means the call itself failed
+    status_ = FINISH;
+    responder_.Finish(reply_, Status::OK, this);
+}
+
 // One Calldata object handling each request thread
 ChatServiceImpl::CallDataSync::CallDataSync(Chat::AsyncService *service, ServerCompletionQueue *cq, std::unordered_map<uint32_t, blockchain::UTXOlist> *utxolists,
                                             std::mutex *io_mutex, std::mutex *utxolists_mutex)
@@ -184,31 +324,23 @@ void ChatServiceImpl::CallDataSync::Proceed() {
         // The actual processing.
         uint32_t wallet_id = request_.wallet_id();
 
-        cd_io_mutex_->lock();
-        std::cout << "Server: received sync request from wallet " << wallet_id << std::endl;
-        cd_io_mutex_->unlock();
-
         // Get utxolist for wallet id
         blockchain::UTXOlist utxolist;
-        if (cd_utxolists_->find(wallet_id) != cd_utxolists_->end()) {
-            utxolist = (*cd_utxolists_)[wallet_id];
-
-            cd_io_mutex_->lock();
-            std::cout << "Server: sending utxolist back to wallet " << wallet_id << std::endl;
-            cd_io_mutex_->unlock();
-        } else {
-            cd_io_mutex_->lock();
-            std::cout << "Server: no utxolist found, sending empty utxolist back to wallet " << wallet_id << std::endl;
-            cd_io_mutex_->unlock();
+        cd_utxolists_mutex_->lock();
+        auto it = cd_utxolists_->find(wallet_id);
+        bool found = it != cd_utxolists_->end();
+        if (found) {
+            utxolist = it->second;
         }
+        cd_utxolists_mutex_->unlock();
 
-        // Add utxolist to reply
+        // Add utxolist to reply, an unknown wallet gets an empty one
         chat::UTXOlist proto_utxolist;
         utxolist.toProtoUTXOlist(&proto_utxolist);
         *reply_.mutable_utxolist() = proto_utxolist;
 
-        responder_.Finish(reply_, Status::OK, this);
         status_ = FINISH;
+        responder_.Finish(reply_, Status::OK, this);
 
         // std::cout << "FINISH" << std::endl;
     } else {
@@ -217,28 +349,100 @@ void ChatServiceImpl::CallDataSync::Proceed() {
     }
 }
 
-void ChatServiceImpl::HandleRpcs()  // This method initiates the handling of incoming RPCs.
+// One Calldata object handling each request thread
+ChatServiceImpl::CallDataFetchBlock::CallDataFetchBlock(Chat::AsyncService *service, ServerCompletionQueue *cq, BlockProvider *provider,
+                                                        std::mutex *io_mutex, std::mutex *provider_mutex)
+    : CallData(service, cq), responder_(&ctx_), cd_io_mutex_(io_mutex), cd_provider_(provider), cd_provider_mutex_(provider_mutex) {
+    Proceed();
+}
+
+// Modified statuses to handle concurrent requests coming to cq_.
+void ChatServiceImpl::CallDataFetchBlock::Proceed() {
+    if (status_ == CREATE) {
+        status_ = START_PROCESS;
+        cd_service_->RequestFetchBlock(&ctx_, &request_, &responder_, cd_cq_, cd_cq_,
+                                       this);
+    } else if (status_ == START_PROCESS) {
+        new CallDataFetchBlock(cd_service_, cd_cq_, cd_provider_, cd_io_mutex_, cd_provider_mutex_);
+
+        // The actual processing.
+        std::string block_hash = request_.blockhash();
+        blockchain::Block block;
+        bool found = false;
+        cd_provider_mutex_->lock();
+        if (*cd_provider_ != nullptr) {
+            found = (*cd_provider_)(block_hash, block);
+        }
+        cd_provider_mutex_->unlock();
+
+        reply_.set_found(found);
+        if (found) {
+            block.toProtoBlock(reply_.mutable_block());
+        }
+
+        status_ = FINISH;
+        responder_.Finish(reply_, Status::OK, this);
+    } else {
+        GPR_ASSERT(status_ == FINISH);
+        delete this;
+    }
+}
+
+void ChatServiceImpl::HandleRpcs(ServerCompletionQueue *cq)  // This method initiates the handling of incoming RPCs.
 // It continuously waits for incoming requests and handles them asynchronously.
 {
-    new CallDataTalk(&service_, cq_.get(), &mq_, &io_mutex_, &mq_mutex_, &cv_);
-    new CallDataNewTx(&service_, cq_.get(), &txq_, &io_mutex_, &txq_mutex_, &cv_);
-    new CallDataSync(&service_, cq_.get(), &utxolists_, &io_mutex_, &utxolists_mutex_);
-
-    CallData *tag;
+    // Every completion queue gets its own handlers, so each thread serves every RPC type
+    new CallDataTalk(&service_, cq, &mq_, decoder_.get(), &reorder_, &known_block_filter_, &known_block_filter_mutex_, &consensus_refused_, &io_mutex_);
+    new CallDataStream(&service_, cq, &mq_, decoder_.get(), &reorder_, &known_block_filter_, &known_block_filter_mutex_, &is_running_, &consensus_refused_, &io_mutex_);
+    new CallDataNewTx(&service_, cq, &txq_, decoder_.get(), &tx_limiter_, &tx_rejected_full_, &io_mutex_);
+    new CallDataNewTxBatch(&service_, cq, &txq_, decoder_.get(), &tx_limiter_, &tx_rejected_full_, &io_mutex_);
+    new CallDataSync(&service_, cq, &utxolists_, &io_mutex_, &utxolists_mutex_);
+    new CallDataFetchBlock(&service_, cq, &block_provider_, &io_mutex_, &block_provider_mutex_);
+
+    void *tag;
     bool ok;
 
-    while (is_running_) {
-        GPR_ASSERT(cq_->Next(reinterpret_cast<void **>(&tag), &ok));
-        GPR_ASSERT(ok);
-        // Call Proceed on the correct type of CallData
-        if (dynamic_cast<CallDataTalk *>(tag)) {
-            static_cast<CallDataTalk *>(tag)->Proceed();
-        } else if (dynamic_cast<CallDataNewTx *>(tag)) {
-            static_cast<CallDataNewTx *>(tag)->Proceed();
-        } else if (dynamic_cast<CallDataSync *>(tag)) {
-            static_cast<CallDataSync *>(tag)->Proceed();
+    // Next() returns false once the queue is shut down & drained
+    while (cq->Next(&tag, &ok)) {
+        CallData *call = static_cast<CallData *>(tag);
+        if (!ok) {
+            // The server is shutting down or the client went away
+            call->Abort();
+            continue;
         }
+        call->Proceed();
+    }
+}
+
+void ChatServiceImpl::setBlockProvider(BlockProvider provider) {
+    std::lock_guard<std::mutex> lock(block_provider_mutex_);
+    block_provider_ = provider;
+}
+
+void ChatServiceImpl::setKnownBlockFilter(KnownBlockFilter filter) {
+    std::lock_guard<std::mutex> lock(known_block_filter_mutex_);
+    known_block_filter_ = filter;
+}
+
+blockchain::Message ChatServiceImpl::decodeMessage_(const chat::Message &message, KnownBlockFilter *filter, std::mutex *filter_mutex) {
+    // Votes are small, only the block of a SEND is worth the lookup
+    if (!message.has_block()) {
+        return blockchain::Message(message);
+    }
+    return blockchain::Message(message, [filter, filter_mutex](const std::string &blk_hash) {
+        std::lock_guard<std::mutex> lock(*filter_mutex);
+        return *filter != nullptr && (*filter)(blk_hash);
+    });
+}
+
+uint64_t ChatServiceImpl::limiterKey_(const std::string &peer) {
+    // "ipv4:10.0.0.1:50312" or "ipv6:[::1]:50312", a client gets a new port with every connection
+    std::string host = peer;
+    size_t colon = peer.rfind(':');
+    if (colon != std::string::npos && colon + 1 < peer.size() && peer.find_first_not_of("0123456789", colon + 1) == std::string::npos) {
+        host = peer.substr(0, colon);
     }
+    return std::hash<std::string>()(host);
 }
 
 void ChatServiceImpl::clearUTXOlists() {
@@ -28,6 +28,65 @@ void Settings::from_json(const json& j, config::Settings& s) {
 
     // Get my_wallet_id from the json
     j.at("myWalletID").get_to(s.my_wallet_id_);
+
+    // Optional consensus parameters
+    if (j.contains("pipelineDepth")) {
+        j.at("pipelineDepth").get_to(s.pipeline_depth_);
+    }
+    if (j.contains("erasureCoding")) {
+        j.at("erasureCoding").get_to(s.erasure_coding_);
+    }
+    if (j.contains("gcWatermark")) {
+        j.at("gcWatermark").get_to(s.gc_watermark_);
+    }
+
+    // Optional server parameters
+    if (j.contains("serverThreads")) {
+        j.at("serverThreads").get_to(s.server_threads_);
+    }
+
+    // Optional client channel parameters
+    if (j.contains("keepaliveTimeMs")) {
+        j.at("keepaliveTimeMs").get_to(s.keepalive_time_ms_);
+    }
+    if (j.contains("keepaliveTimeoutMs")) {
+        j.at("keepaliveTimeoutMs").get_to(s.keepalive_timeout_ms_);
+    }
+    if (j.contains("reconnectBackoffMinMs")) {
+        j.at("reconnectBackoffMinMs").get_to(s.reconnect_backoff_min_ms_);
+    }
+    if (j.contains("reconnectBackoffMaxMs")) {
+        j.at("reconnectBackoffMaxMs").get_to(s.reconnect_backoff_max_ms_);
+    }
+    if (j.contains("sendWindow")) {
+        j.at("sendWindow").get_to(s.send_window_);
+    }
+
+    // Optional admission control parameters
+    if (j.contains("txQueueCapacity")) {
+        j.at("txQueueCapacity").get_to(s.tx_queue_capacity_);
+    }
+    if (j.contains("mempoolCapacity")) {
+        j.at("mempoolCapacity").get_to(s.mempool_capacity_);
+    }
+    if (j.contains("mempoolMaxBytes")) {
+        j.at("mempoolMaxBytes").get_to(s.mempool_max_bytes_);
+    }
+    if (j.contains("verifyThreads")) {
+        j.at("verifyThreads").get_to(s.verify_threads_);
+    }
+    if (j.contains("eventThreads")) {
+        j.at("eventThreads").get_to(s.event_threads_);
+    }
+    if (j.contains("proposeIntervalMs")) {
+        j.at("proposeIntervalMs").get_to(s.propose_interval_ms_);
+    }
+    if (j.contains("txRateLimit")) {
+        j.at("txRateLimit").get_to(s.tx_rate_limit_);
+    }
+    if (j.contains("txBurst")) {
+        j.at("txBurst").get_to(s.tx_burst_);
+    }
 }
 
 void Settings::to_json(json& j, const config::Settings& s) {
@@ -50,6 +109,31 @@ void Settings::to_json(json& j, const config::Settings& s) {
 
     // Set my_wallet_id in the json
     j["myWalletID"] = s.my_wallet_id_;
+
+    // Set consensus parameters in the json
+    j["pipelineDepth"] = s.pipeline_depth_;
+    j["erasureCoding"] = s.erasure_coding_;
+    j["gcWatermark"] = s.gc_watermark_;
+
+    // Set server parameters in the json
+    j["serverThreads"] = s.server_threads_;
+
+    // Set client channel parameters in the json
+    j["keepaliveTimeMs"] = s.keepalive_time_ms_;
+    j["keepaliveTimeoutMs"] = s.keepalive_timeout_ms_;
+    j["reconnectBackoffMinMs"] = s.reconnect_backoff_min_ms_;
+    j["reconnectBackoffMaxMs"] = s.reconnect_backoff_max_ms_;
+    j["sendWindow"] = s.send_window_;
+
+    // Set admission control parameters in the json
+    j["txQueueCapacity"] = s.tx_queue_capacity_;
+    j["mempoolCapacity"] = s.mempool_capacity_;
+    j["mempoolMaxBytes"] = s.mempool_max_bytes_;
+    j["verifyThreads"] = s.verify_threads_;
+    j["eventThreads"] = s.event_threads_;
+    j["proposeIntervalMs"] = s.propose_interval_ms_;
+    j["txRateLimit"] = s.tx_rate_limit_;
+    j["txBurst"] = s.tx_burst_;
 }
 
 std::string Settings::to_address(std::string ip_addr, uint32_t port) {
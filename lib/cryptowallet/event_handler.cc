@@ -0,0 +1,130 @@
+#include "cryptowallet/event_handler.h"
+
+#include <algorithm>
+
+using namespace cryptowallet;
+
+EventHandler::EventHandler(uint32_t num_threads) {
+    num_threads = std::max<uint32_t>(1, num_threads);
+    for (uint32_t i = 0; i < num_threads; i++) {
+        workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        w->th = std::thread([this, w]() { EventProcess(*w); });
+    }
+}
+
+EventHandler::~EventHandler() {
+    Stop();
+}
+
+EventHandler::SubscriptionId EventHandler::SubscriberEvent(Event event, HandleEvent func) {
+    std::lock_guard<std::mutex> lock(_mutexSubscriber);
+    auto& subscribers = subsMap_[event];
+    if (subscribers.size() >= EVENT_MAX_SUBSCRIBERS_) {
+        return 0;
+    }
+    subscribers.emplace_back(next_id_, std::move(func));
+    return next_id_++;
+}
+
+bool EventHandler::releaseSubscriberEvent(Event event, SubscriptionId id) {
+    std::lock_guard<std::mutex> lock(_mutexSubscriber);
+    auto& subscribers = subsMap_[event];
+    for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+        if (it->first == id) {
+            subscribers.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventHandler::PublishEvent(Event event) {
+    Enqueue_(EventPublishNode{event, nullptr});
+}
+
+void EventHandler::PostTask(Event event, HandleEvent task) {
+    if (task) {
+        Enqueue_(EventPublishNode{event, std::move(task)});
+    }
+}
+
+void EventHandler::Enqueue_(EventPublishNode node) {
+    Worker& worker = worker_(node.event);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!running_) {
+            return;
+        }
+        worker.publist.push_back(std::move(node));
+    }
+    worker.cv.notify_one();
+}
+
+void EventHandler::Stop() {
+    for (auto& worker : workers_) {
+        // Set under the worker lock, a worker cannot miss the wakeup between its check and its wait
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        running_ = false;
+    }
+    for (auto& worker : workers_) {
+        worker->cv.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker->th.joinable()) {
+            worker->th.join();
+        }
+    }
+}
+
+void EventHandler::EventProcess(Worker& worker) {
+    while (true) {
+        EventPublishNode cur {Event::NONE, nullptr};
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&]() { return !worker.publist.empty() || !running_; });
+            // Published events are still run after Stop()
+            if (worker.publist.empty()) {
+                return;
+            }
+            cur = std::move(worker.publist.front());
+            worker.publist.pop_front();
+        }
+
+        // a one-shot task runs once & is released with `cur`
+        if (cur.task) {
+            cur.task();
+            continue;
+        }
+
+        // the subscribers run without the lock, so they may subscribe & publish themselves
+        std::vector<std::pair<SubscriptionId, HandleEvent>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(_mutexSubscriber);
+            auto it = subsMap_.find(cur.event);
+            if (it != subsMap_.end()) {
+                subscribers = it->second;
+            }
+        }
+        for (auto& sub : subscribers) {
+            sub.second();
+        }
+    }
+}
+
+uint32_t EventHandler::index_(Event event) {
+    switch (event) {
+        case Event::SYNC:
+            return 0;
+        case Event::TX:
+            return 1;
+        case Event::PROPOSE:
+            return 2;
+        case Event::DBSTORE:
+            return 3;
+        default:
+            return 0;
+    }
+}
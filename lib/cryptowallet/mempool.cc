@@ -0,0 +1,241 @@
+#include "cryptowallet/mempool.h"
+
+#include <algorithm>
+
+using namespace cryptowallet;
+
+size_t Mempool::footprint_(const blockchain::Transaction& tx) {
+    size_t bytes = sizeof(blockchain::Transaction);
+    bytes += tx.getInputs().size() * sizeof(blockchain::Input);
+    bytes += tx.getOutputs().size() * sizeof(blockchain::Output);
+    for (const std::string& part : tx.getSenderSig()) {
+        bytes += part.size();
+    }
+    signature::SigKey key = tx.getPublicKey();
+    for (const std::string& part : key.S0) {
+        bytes += part.size();
+    }
+    for (const std::string& part : key.S1) {
+        bytes += part.size();
+    }
+    return bytes;
+}
+
+Mempool::AddResult Mempool::add(const blockchain::Transaction& tx) {
+    TxKey key(tx.getSenderID(), tx.getID());
+    size_t tx_bytes = footprint_(tx);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TxKey> replaced;
+    std::vector<TxKey> evicted;
+    AddResult result = plan_(key, tx, tx_bytes, replaced, evicted);
+    if (result != AddResult::ADDED && result != AddResult::REPLACED) {
+        return result;
+    }
+    for (const TxKey& old_key : replaced) {
+        erase_(by_id_.find(old_key));
+    }
+    for (const TxKey& old_key : evicted) {
+        erase_(by_id_.find(old_key));
+    }
+    evicted_ += evicted.size();
+
+    age_.push_back(key);
+    pend_(key);
+    by_id_.emplace(key, Entry{tx, tx_bytes, std::prev(age_.end())});
+    for (const blockchain::Input& input : tx.getInputs()) {
+        by_outpoint_.emplace(outpoint_(key.first, input), key);
+    }
+    bytes_ += tx_bytes;
+    return result;
+}
+
+Mempool::AddResult Mempool::check(const blockchain::Transaction& tx) {
+    TxKey key(tx.getSenderID(), tx.getID());
+    size_t tx_bytes = footprint_(tx);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TxKey> replaced;
+    std::vector<TxKey> evicted;
+    return plan_(key, tx, tx_bytes, replaced, evicted);
+}
+
+Mempool::AddResult Mempool::plan_(const TxKey& key, const blockchain::Transaction& tx, size_t tx_bytes, std::vector<TxKey>& replaced, std::vector<TxKey>& evicted) const {
+    if (by_id_.find(key) != by_id_.end()) {
+        return AddResult::DUPLICATE;
+    }
+    if (conflicts_(key, tx, replaced)) {
+        return AddResult::CONFLICT;
+    }
+    size_t count = by_id_.size() - replaced.size() + 1;
+    size_t bytes = bytes_ + tx_bytes;
+    for (const TxKey& old_key : replaced) {
+        bytes -= by_id_.find(old_key)->second.bytes;
+    }
+
+    // Over a cap, the newest pending transactions of the most loaded wallet make room
+    // The wallet has to keep at least as many pending transactions as the newcomer's wallet then
+    if ((count > capacity_ || bytes > max_bytes_) && !load_.empty() && load_.rbegin()->second != key.first) {
+        uint16_t victim = load_.rbegin()->second;
+        const std::set<uint32_t>& victim_ids = pending_by_sender_.find(victim)->second;
+        auto own = pending_by_sender_.find(key.first);
+        size_t own_pending = (own == pending_by_sender_.end() ? 0 : own->second.size()) - replaced.size() + 1;
+        for (auto id = victim_ids.rbegin(); id != victim_ids.rend() && (count > capacity_ || bytes > max_bytes_); id++) {
+            if (victim_ids.size() - evicted.size() - 1 < own_pending) {
+                break;
+            }
+            evicted.push_back(TxKey(victim, *id));
+            count--;
+            bytes -= by_id_.find(evicted.back())->second.bytes;
+        }
+    }
+    if (count > capacity_ || bytes > max_bytes_) {
+        return AddResult::FULL;
+    }
+    return replaced.empty() ? AddResult::ADDED : AddResult::REPLACED;
+}
+
+bool Mempool::contains(uint16_t sender_id, uint32_t tx_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_id_.find(TxKey(sender_id, tx_id)) != by_id_.end();
+}
+
+bool Mempool::conflicts(const blockchain::Transaction& tx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TxKey> replaced;
+    return conflicts_(TxKey(tx.getSenderID(), tx.getID()), tx, replaced);
+}
+
+bool Mempool::conflicts_(const TxKey& key, const blockchain::Transaction& tx, std::vector<TxKey>& replaced) const {
+    for (const blockchain::Input& input : tx.getInputs()) {
+        auto spent = by_outpoint_.find(outpoint_(key.first, input));
+        if (spent == by_outpoint_.end() || spent->second == key) {
+            continue;
+        }
+        // Only a newer transaction of the wallet replaces, and only transactions that are not proposed yet
+        const Entry& entry = by_id_.find(spent->second)->second;
+        if (spent->second.second >= key.second || entry.age == age_.end()) {
+            return true;
+        }
+        if (std::find(replaced.begin(), replaced.end(), spent->second) == replaced.end()) {
+            replaced.push_back(spent->second);
+        }
+    }
+    return false;
+}
+
+std::vector<blockchain::Transaction> Mempool::take(size_t max_count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<blockchain::Transaction> txs;
+    while (!age_.empty() && txs.size() < max_count) {
+        auto it = by_id_.find(age_.front());
+        txs.push_back(it->second.tx);
+        unpend_(it->first);
+        age_.pop_front();
+        it->second.age = age_.end();
+    }
+    return txs;
+}
+
+size_t Mempool::release(const std::vector<blockchain::Transaction>& txs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t released = 0;
+    // In reverse, so the released transactions keep their order in front of the pending ones
+    for (auto tx = txs.rbegin(); tx != txs.rend(); tx++) {
+        auto it = by_id_.find(TxKey(tx->getSenderID(), tx->getID()));
+        if (it == by_id_.end() || it->second.age != age_.end()) {
+            continue;
+        }
+        age_.push_front(it->first);
+        pend_(it->first);
+        it->second.age = age_.begin();
+        released++;
+    }
+    return released;
+}
+
+bool Mempool::remove(uint16_t sender_id, uint32_t tx_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_id_.find(TxKey(sender_id, tx_id));
+    if (it == by_id_.end()) {
+        return false;
+    }
+    erase_(it);
+    return true;
+}
+
+size_t Mempool::removeIncluded(const std::vector<blockchain::Transaction>& txs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = 0;
+    for (const blockchain::Transaction& tx : txs) {
+        auto it = by_id_.find(TxKey(tx.getSenderID(), tx.getID()));
+        if (it != by_id_.end()) {
+            erase_(it);
+            removed++;
+        }
+        // Pooled transactions spending the same outputs can never be valid anymore
+        for (const blockchain::Input& input : tx.getInputs()) {
+            auto spent = by_outpoint_.find(outpoint_(tx.getSenderID(), input));
+            if (spent != by_outpoint_.end()) {
+                erase_(by_id_.find(spent->second));
+                removed++;
+            }
+        }
+    }
+    return removed;
+}
+
+size_t Mempool::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_id_.size();
+}
+
+size_t Mempool::pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return age_.size();
+}
+
+size_t Mempool::bytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+size_t Mempool::evicted() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return evicted_;
+}
+
+void Mempool::pend_(const TxKey& key) {
+    std::set<uint32_t>& ids = pending_by_sender_[key.first];
+    if (!ids.empty()) {
+        load_.erase(std::make_pair(ids.size(), key.first));
+    }
+    ids.insert(key.second);
+    load_.insert(std::make_pair(ids.size(), key.first));
+}
+
+void Mempool::unpend_(const TxKey& key) {
+    auto it = pending_by_sender_.find(key.first);
+    load_.erase(std::make_pair(it->second.size(), key.first));
+    it->second.erase(key.second);
+    if (it->second.empty()) {
+        pending_by_sender_.erase(it);
+    } else {
+        load_.insert(std::make_pair(it->second.size(), key.first));
+    }
+}
+
+void Mempool::erase_(std::unordered_map<TxKey, Entry, KeyHash>::iterator it) {
+    for (const blockchain::Input& input : it->second.tx.getInputs()) {
+        auto spent = by_outpoint_.find(outpoint_(it->first.first, input));
+        if (spent != by_outpoint_.end() && spent->second == it->first) {
+            by_outpoint_.erase(spent);
+        }
+    }
+    if (it->second.age != age_.end()) {
+        unpend_(it->first);
+        age_.erase(it->second.age);
+    }
+    bytes_ -= it->second.bytes;
+    by_id_.erase(it);
+}
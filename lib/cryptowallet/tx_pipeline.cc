@@ -0,0 +1,57 @@
+#include "cryptowallet/tx_pipeline.h"
+
+using namespace cryptowallet;
+
+TxPipeline::TxPipeline(uint32_t num_threads, VerifyFn verify, CommitFn commit)
+    : verify_(verify), commit_(commit), verified_(TX_VERIFIED_CAPACITY_), verifiers_(num_threads) {
+    committer_ = std::thread([this]() { RunCommit_(); });
+}
+
+TxPipeline::~TxPipeline() {
+    Stop();
+}
+
+void TxPipeline::Submit(std::vector<blockchain::Transaction>& txs) {
+    if (!running_) {
+        return;
+    }
+    for (blockchain::Transaction& tx : txs) {
+        uint16_t sender = tx.getSenderID();
+        auto shared = std::make_shared<blockchain::Transaction>(std::move(tx));
+        verifiers_.Submit(sender, [this, shared]() {
+            Verified verified{std::move(*shared), false};
+            verified.valid = verify_(verified.tx);
+            // A full queue pushes back on the lane, nothing drains it once the commit thread stopped
+            verified_.pushWait(std::move(verified), committing_);
+        });
+    }
+}
+
+void TxPipeline::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    // Verified transactions are still committed while the lanes drain
+    verifiers_.Stop();
+    committing_ = false;
+    verified_.wake();
+    verified_.wakeProducers();
+    committer_.join();
+}
+
+void TxPipeline::RunCommit_() {
+    std::vector<Verified> batch;
+    while (true) {
+        bool running = committing_;
+        if (running) {
+            verified_.wait();
+        }
+        if (verified_.popAll(batch)) {
+            commit_(batch);
+            batch.clear();
+        }
+        if (!running) {
+            break;
+        }
+    }
+}
@@ -35,47 +35,79 @@ void validator::UpdateKeys(uint32_t sender_id, const blockchain::Transaction& tx
 }
 
 
-int validator::OnTxReply(std::vector<transaction>& txlist) {
-    std::cout << "Validator.cc: " << "OnTxReply(): " << "iterating new txs of size "  << txlist.size() << std::endl;
-  
-    for (auto& tx: txlist) {
-        OnRecvTx(tx);
+int validator::OnTxReply(std::vector<TxPipeline::Verified>& txlist) {
+    std::lock_guard<std::mutex> lock(*_mutex_state);
+
+    int received = 0;
+    for (auto& verified: txlist) {
+        received += OnRecvTx(verified.tx, verified.valid);
+    }
+    txs_pooled_ += received;
+
+    // wakes up the proposing thread of the leader
+    if (received > 0) {
+        _mutex_propose->lock();
+        _mutex_propose->unlock();
+        _cond_propose->notify_all();
     }
+    return received;
 }
 
-int validator::OnRecvTx(transaction& tx) {
+bool validator::VerifyTx(const transaction& tx) {
 
-    std::cout << "Validator.cc: " << "OnRecvTx(): " << "new tx received..." << std::endl;
+    // a double spend that cannot replace the pooled tx & a tx that finds no room in the pool
+    // (after replacement & eviction) are turned away before they cost a signature check
+    Mempool::AddResult fits = memory_pool_.check(tx);
+    if (fits == Mempool::AddResult::CONFLICT) {
+        mempool_conflicts_++;
+        return false;
+    }
+    if (fits == Mempool::AddResult::FULL) {
+        mempool_rejected_++;
+        return false;
+    }
+
+    // checks the signature of the Sign(tx) using the PK the tx carries, which OnRecvTx stores as PK_{i,n}
+    if (signature::Verify(tx.getDigest(), tx.getSenderSig(), tx.getPublicKey()) != 1) {
+        return false;
+    }
+    return true;
+}
+
+int validator::OnRecvTx(transaction& tx, bool valid) {
 
     uint16_t wallet_id = tx.getSenderID();
 
-    // updates the PK set < id_i,PK_{n+1}> before verifying.
+    // updates the PK set < id_i,PK_{n+1}> in arrival order.
     // Notes: the PK gets updated despite the invalidity of signature.
     UpdateKeys(wallet_id, tx); 
-    std::cout << "Validator.cc: " << "OnRecvTx(): " << "key pairs updated..." << std::endl;
-    
-    // checks the signature of the Sign(tx) using PK_{i,n}
-    int valid = signature::Verify(tx.getDigest(), 
-                                tx.getSenderSig(),
-                                pk_sets_[wallet_id]);
-                                
-     std::cout << "Validator.cc: " << "OnRecvTx(): " << "new tx verified (can be invalid)..." << std::endl;
+
+    // VerifyTx turned the tx away, the pool rejections are counted there
+    if (!valid) {
+        return 0;
+    }
 
     /* checks whether 
      * 1) the output(h,i) is in the local UTXO set
      * 2) spending conditions(drop when not sum of inputs == sum of outputs).
-     * 3) signature is valid
      */ 
-    if (valid  != 1 || !tx.checkSpendingConditions(utxo_sets_[wallet_id], wallets_ids_)) {
-        std::cout << "Validator.cc: " << "OnRecvTx(): " << "tx is invalid!!" <<  valid  << "  " << std::boolalpha << tx.checkSpendingConditions(utxo_sets_[wallet_id], wallets_ids_) << std::endl;
+    if (!tx.checkSpendingConditions(utxo_sets_[wallet_id], wallets_ids_)) {
         return 0;
     }
-    
-    std::cout << "Validator.cc: " << "OnRecvTx(): " << "tx is valid..." << std::endl;
 
     // adds to the tx memory pool
-    memory_pool_.push_back(tx);  
-    std::cout << "Validator.cc: " << "OnRecvTx(): " << "added to memory pool..." << std::endl;
+    Mempool::AddResult added = memory_pool_.add(tx);
+    if (added == Mempool::AddResult::DUPLICATE) {
+        return 0;
+    }
+    if (added == Mempool::AddResult::CONFLICT) {
+        mempool_conflicts_++;
+        return 0;
+    }
+    if (added == Mempool::AddResult::FULL) {
+        mempool_rejected_++;
+        return 0;
+    }
     return 1;
 
 }
@@ -85,21 +117,26 @@ int validator::CreateBlk(Block& bx) {
 
     assert(/*"Only the leader can initialize and propose a new block",*/ node_->isLeader());
 
+    std::lock_guard<std::mutex> lock(*_mutex_state);
+
     // Block bx;
     std::vector<transaction> confirmed_tx;
     
-    if (memory_pool_.empty()) return 0;
+    // oldest transactions first, they stay reserved in the pool until the block is delivered
+    std::vector<transaction> pooled = memory_pool_.take();
+    if (pooled.empty()) return 0;
+
+    // discarded txs are counted, not logged one by one
+    int discarded = 0;
 
-    while (!memory_pool_.empty()) {
-        blockchain::Transaction cur_tx = memory_pool_[memory_pool_.size() - 1];
-        memory_pool_.pop_back();
-        std::cout << "Validator.cc: " << "CreateBlk(): " << "poped a tx" << std::endl;
+    for (auto& cur_tx: pooled) {
         UTXOlist cur_utxo = utxo_sets_[cur_tx.getSenderID()];
         uint32_t wallet_id = cur_tx.getSenderID();
         
         // check whether the tx is consistent with local UTXO set
         if (!cur_tx.checkSpendingConditions(utxo_sets_[wallet_id], wallets_ids_)) {
-            std::cout << "Validator.cc: " << "CreateBlk(): " << "the tx is discarded due to inconsistency with local UTXO set..." << std::endl;
+            discarded++;
+            memory_pool_.remove(cur_tx.getSenderID(), cur_tx.getID());
             continue;
         }
 
@@ -111,7 +148,8 @@ int validator::CreateBlk(Block& bx) {
         
         // check whether the tx is consistent with the bx(double spending)
         if (!bx.verifyTxConsist(cur_tx)) {
-            std::cout << "Validator.cc: " << "CreateBlk(): " << "the tx is discarded due to inconsistency with the block..." << std::endl;
+            discarded++;
+            memory_pool_.remove(cur_tx.getSenderID(), cur_tx.getID());
             continue;
         }
 
@@ -121,6 +159,10 @@ int validator::CreateBlk(Block& bx) {
 
     }
     
+    if (discarded > 0) {
+        std::cout << "Validator.cc: " << "CreateBlk(): " << discarded << " txs discarded due to inconsistency with the local UTXO set or the block..." << std::endl;
+    }
+
     // finalize the block
     bx.finalize();
     
@@ -131,10 +173,13 @@ int validator::CreateBlk(Block& bx) {
 
 int validator::OnAgreeBlk(blockchain::Block& bx) {
     
+    std::lock_guard<std::mutex> lock(*_mutex_state);
     std::vector<blockchain::Transaction> tx_list = bx.getTransactions();
 
+    // drops the delivered txs & the pooled txs spending the same outputs
+    memory_pool_.removeIncluded(tx_list);
+
     for (auto& cur_tx: tx_list) {
-        std::cout << "Validator.cc: " << "OnAgreeBlk(): " << "iterating a tx" << std::endl;
         UTXOlist cur_utxo = utxo_sets_[cur_tx.getSenderID()];
         uint32_t wallet_id = cur_tx.getSenderID();
 
@@ -151,9 +196,6 @@ int validator::OnAgreeBlk(blockchain::Block& bx) {
                Output cur_out = cur_tx.getOutputAt(i);
                UTXO cur_utxo = UTXO(cur_tx.getID(), i, cur_out);
             }
-            else {
-               std::cout << "Validator.cc: " << "CreateBlk(): " << "the tx is discarded due to inconsistency with the UTXO??..." << std::endl;
-            }
         }
 
     }
@@ -176,6 +218,7 @@ int validator::OnAgreeBlk(blockchain::Block& bx) {
 */
 int validator::OnSyncReply(const std::vector<uint32_t>& idlist) {
    //std::cout << "Validator.cc: " << "OnSyncReply(): " << "new utxosets updated with the servers" <<std::endl;
+   std::lock_guard<std::mutex> lock(*_mutex_state);
    _mutex_grpc->lock();
    _grpcServer->setUTXOlists(utxo_sets_);
    _mutex_grpc->unlock();
@@ -187,7 +230,6 @@ int validator::Propose(blockchain::Block& blk) const
     assert(/*"Only the leader can propose",*/ node_->isLeader());
     // bracha::LeaderNode* node = dynamic_cast<bracha::LeaderNode*>(node_);
     // if (!node) throw std::logic_error("cannot cast node to Leadernode");
-    std::cout << "validator.cc: " << "Propose(): " << "propose a new blk" << std::endl;
     return (dynamic_cast<bracha::LeaderNode*>(node_))->Propose(blk);
 }
 
@@ -200,9 +242,7 @@ void validator::OnRequest(const RequestCall<T>& req,
 {
     RunTaskInLoop(event, [=]() {
         if (req(list)) {
-            std::cout << "Validator.cc: " << "OnRequest(): " << "new (TX) lists got..." << std::endl;
             done(list);
-            std::cout << "Validator.cc: " << "OnRequest(): " << "callback done..." << std::endl;
         }
     });
 }
@@ -213,12 +253,9 @@ int validator::Listen()
     std::cout << "Validator.cc: " << "Listen(): " << "started listening thread..." << std::endl;
     
     while (_listen) {
+        // only NewTx requests & Stop() wake up this thread, consensus traffic goes to the consensus thread
+        if (!_grpcServer->waitRequests()) continue;
         std::unique_lock<std::mutex> lck(*_mutex_grpc);
-        // std::cout << "Validator.cc: " << "Listen(): " << "waiting for a new request..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        //std:: cout << "new REQ?  " << std::boolalpha << _grpcServer->newRequests() << std::endl;
-        _cond_grpc->wait(lck, [this]() { return _grpcServer->newRequests() || !_listen;}); 
-        std::cout << "Validator.cc: " << "Listen(): " << "new request(tx) detected..." << std::endl;
         
         std::vector<transaction> tx_list;
         //std::vector<uint32_t> sync_idlist;
@@ -227,10 +264,11 @@ int validator::Listen()
         // warning : because the static callback function is really a pain to work on with non-static data members
         
         // OnRequest<uint32_t>(std::bind(&comms::ChatServiceImpl::getSyncRequests, _grpcServer, std::ref(sync_idlist)), std::ref(sync_idlist), Event::SYNC, std::bind(&validator::OnSyncReply, this, std::ref(sync_idlist));
-        OnRequest<transaction>(std::bind(&comms::ChatServiceImpl::getTransactions, _grpcServer, std::ref(tx_list)), std::ref(tx_list), Event::TX, std::bind(&validator::OnTxReply, this, std::ref(tx_list)));
-        
-        _mutex_grpc->unlock();
-        std::cout << "Validator.cc: " << "Listen(): " << "Onrequest and callback finished..." << std::endl;
+        // the server decoded the txs already, the pipeline verifies them in parallel & commits them via OnTxReply
+        _grpcServer->getTransactions(tx_list);
+        lck.unlock();
+
+        tx_pipeline_->Submit(tx_list);
         
     }
 }
@@ -246,63 +284,83 @@ void validator::ConsensusProcess()
 void validator::ProposeProcess()
 {
     assert(/*"Only the leader can propose new blocks",*/ node_->isLeader());
+    std::unique_lock<std::mutex> lock(*_mutex_propose);
     while (_propose) 
     {
-        std::this_thread::sleep_for(std::chrono::seconds(10));
-        RunTaskInLoop(Event::PROPOSE, [=]() {
+        // sleeps until txs wait in the memory pool & the previous proposal is done
+        _cond_propose->wait(lock, [this]() { return !_propose || (!propose_pending_ && memory_pool_.pending() > 0); });
+        if (!_propose) break;
+
+        // collects more txs for the block, the proposal timer is only cut short by Stop()
+        _cond_propose->wait_for(lock, std::chrono::milliseconds(propose_interval_ms_), [this]() { return !_propose; });
+        if (!_propose) break;
+
+        propose_pending_ = true;
+        RunTaskInLoop(Event::PROPOSE, [this]() {
             Block blk;
             if (CreateBlk(blk)) {
-                std::cout << "Validator.cc: " << "ProposeConsensus(): " << "blk creation finished with a total " << blk.getTransactions().size() << " txes added" <<std::endl;
-                
-                Propose(blk);
+                // the txs of a block that was not broadcast wait for the next one
+                if (Propose(blk)) {
+                    blks_proposed_++;
+                } else {
+                    memory_pool_.release(blk.getTransactions());
+                }
             }
+            _mutex_propose->lock();
+            propose_pending_ = false;
+            _mutex_propose->unlock();
+            _cond_propose->notify_all();
         });
     }
 }
 
 
-/**
- * @bug: commented for exception raised after line 279, can be wrong capture of lambda function
-*/
-void validator::DBProcess()
+void validator::OnDeliverBlk(bracha::DeliveredBlock&& delivered)
 {
+    blks_delivered_++;
+    RunTaskInLoop(Event::DBSTORE, [this, blk = std::move(delivered.block)]() mutable {
+        //  update the UTXO lists
+        OnAgreeBlk(blk);
+        //db_->addBlock(blk);
+
+        // sync with the lists
+        std::vector<uint32_t> tlist;
+        OnSyncReply(tlist);
+    });
+}
 
-     while (_DBstore) 
-     {
-        std::this_thread::sleep_for(std::chrono::seconds(10));
- 
-        if (node_->isConsensus()) {
-            //std::vector<blockchain::Block> blist = node_->getConsensusBlocks(false);
-            /*for (auto&blk : blist) {
-                if (find(blk_hashes_.begin(), blk_hashes_.end(), blk) != blk_hashes_.end()) {
-                     blk_hashes_.emplace_back(blk);
-                }
-                else continue;
-            }*/
-            blist_ = node_->getConsensusBlocks(true);
-            std::cout << "Validator.cc: " << "DBProcess(): " << "blk accepted with a total number of " << blist_.size() << "" << std::endl;
-            if (!blist_.empty()) {
-             RunTaskInLoop(Event::DBSTORE, [=]() {
-               //  update the UTXO lists
-               for (auto& blk: blist_) {
-                   OnAgreeBlk(blk);
-                   //db_->addBlock(blk);
-                }
-                
-                // sync with the lists
-                std::vector<uint32_t> tlist;
-                OnSyncReply(tlist);
-                
-                // store the block in blockchain
-                blist_.clear();
-            });
-           }
-            
-          // TODO: start the consensus thread again
-          //_consensus_th = std::thread(std::bind(&Validator::ConsensusProcess, this));
-       }
-       
+
+void validator::OnAbandonBlk(const blockchain::Block& blk)
+{
+    // only the txs this validator took for the block are in flight, the others are skipped
+    if (memory_pool_.release(blk.getTransactions()) > 0) {
+        _mutex_propose->lock();
+        _mutex_propose->unlock();
+        _cond_propose->notify_all();
     }
 }
 
 
+void validator::Stop()
+{
+    _listen = false;
+    _mutex_propose->lock();
+    _propose = false;
+    _mutex_propose->unlock();
+
+    _grpcServer->wakeRequests();
+    _cond_propose->notify_all();
+    // also releases a proposal waiting for a free pipeline slot
+    node_->Stop();
+
+    if (_listen_th.joinable()) _listen_th.join();
+    if (_blkpropose_th.joinable()) _blkpropose_th.join();
+    if (_consensus_th.joinable()) _consensus_th.join();
+    node_->setDeliveryHandler(nullptr);
+    node_->setAbandonHandler(nullptr);
+
+    if (tx_pipeline_) tx_pipeline_->Stop();
+    _evecenter->Stop();
+}
+
+
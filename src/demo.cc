@@ -151,12 +151,9 @@ int main() {
    /* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
    
 
-   // Join the threads
+   // Stop & join the threads
    for (int i = 0;i < n; i++) {
-       validators[i]._blkpropose_th.join();
-       validators[i]._consensus_th.join();
-       validators[i]._listen_th.join();
-       validators[i]._DBstore_th.join();
+       validators[i].Stop();
    }
    
 }
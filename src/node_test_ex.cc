@@ -52,9 +52,13 @@ config::Settings get_local_settings(int num_servers, int num_wallets) {
  *   - value: 10, walletID: 203
  */
 
-int main() {
+int main(int argc, char** argv) {
     // Create settings
     config::Settings settings = get_local_settings(3, 2);
+    // Run with --erasure to disperse the blocks in erasure coded fragments
+    settings.setErasureCoding(argc > 1 && std::string(argv[1]) == "--erasure");
+    // Keep a single delivered block in full, the older ones are compacted right away
+    settings.setGcWatermark(1);
     // config::Settings settings("../../settings_demo.json");
     const int SLEEP = 100;
     std::mutex io_mutex;
@@ -120,9 +124,9 @@ int main() {
 
     // Create servers
     std::cout << "Starting servers" << std::endl;
-    comms::ChatServiceImpl serverLeader;
-    comms::ChatServiceImpl server1;
-    comms::ChatServiceImpl server2;
+    comms::ChatServiceImpl serverLeader(settings);
+    comms::ChatServiceImpl server1(settings);
+    comms::ChatServiceImpl server2(settings);
     std::thread serverLeader_thread(&comms::ChatServiceImpl::Run, &serverLeader, settings.getLeaderInfo().port);
     std::thread server1_thread(&comms::ChatServiceImpl::Run, &server1, settings.getValidatorInfo(1).port);
     std::thread server2_thread(&comms::ChatServiceImpl::Run, &server2, settings.getValidatorInfo(2).port);
@@ -169,7 +173,7 @@ int main() {
     std::thread nodeLeader_thread(&bracha::LeaderNode::RunProtocol, &nodeLeader, true);
     std::thread node1_thread(&bracha::Node::RunProtocol, &node1, true);
     std::thread node2_thread(&bracha::Node::RunProtocol, &node2, true);
-    while (nodeLeader.isConsensus() || node1.isConsensus() || node2.isConsensus()) {
+    while (!nodeLeader.isRunning() || !node1.isRunning() || !node2.isRunning()) {
         std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP));
     }
     assert(!nodeLeader.isConsensus());
@@ -178,7 +182,7 @@ int main() {
     std::cout << "Leader proposes block: " << block.getHeader().getID().substr(0, 10) << std::endl;
     nodeLeader.Propose(block);
     std::cout << "Waiting for consensus" << std::endl;
-    bool leader_con, node1_con, node2_con = false;
+    bool leader_con = false, node1_con = false, node2_con = false;
     while (!(leader_con && node1_con && node2_con)) {
         if (nodeLeader.isConsensus() != leader_con) {
             std::cout << "Leader consensus: " << nodeLeader.isConsensus() << std::endl;
@@ -208,11 +212,12 @@ int main() {
     blockchain::Block block_node2 = node2.getReceivedBlock(voted_hash_node2);
     int n = settings.getTotalNumberOfValidators();
     int f = settings.getNumberOfFaultyValidators();
-    int min_sigs = 1 + floor((n + f + 1) / 2) + 2 * f + 1;
-    assert(block_leader.getValidatorSignatures().size() >= min_sigs);
-    assert(block_node1.getValidatorSignatures().size() >= min_sigs);
-    assert(block_node2.getValidatorSignatures().size() >= min_sigs);
-    std::cout << "All nodes received at least " << min_sigs << " signatures" << std::endl;
+    // The quorum certificate holds one signature per validator
+    int min_sigs = 2 * f + 1;
+    assert(block_leader.getCertificate().verify(block_hash, min_sigs));
+    assert(block_node1.getCertificate().verify(block_hash, min_sigs));
+    assert(block_node2.getCertificate().verify(block_hash, min_sigs));
+    std::cout << "All nodes received at least " << min_sigs << " valid signatures" << std::endl;
     block.removeSignatures();
     block_leader.removeSignatures();
     block_node1.removeSignatures();
@@ -221,48 +226,41 @@ int main() {
     assert(block == block_node1);
     assert(block == block_node2);
     std::cout << "Received blocks are correct" << std::endl;
-    assert(nodeLeader.getConsensusBlocks(false).size() == 1);
-    assert(node1.getConsensusBlocks(false).size() == 1);
-    assert(node2.getConsensusBlocks(false).size() == 1);
-
-    // Closing threads
-    nodeLeader_thread.join();
-    node1_thread.join();
-    node2_thread.join();
-
-    // Copy nodes
-    std::cout << "Copying nodes" << std::endl;
-    bracha::LeaderNode nodeLeader_copy2(nodeLeader);
-    bracha::Node node1_copy2(node1);
-    std::cout << "Nodes copied" << std::endl;
-
-    // Move nodes
-    std::cout << "Moving nodes" << std::endl;
-    bracha::LeaderNode nodeLeader_move2(std::move(nodeLeader_copy2));
-    bracha::Node node1_move2(std::move(node1_copy2));
-    std::cout << "Nodes moved" << std::endl;
+    assert(nodeLeader.getConsensusBlocks(true).size() == 1);
+    assert(node1.getConsensusBlocks(true).size() == 1);
+    assert(node2.getConsensusBlocks(true).size() == 1);
+    assert(!nodeLeader.isConsensus());
+    assert(!node1.isConsensus());
+    assert(!node2.isConsensus());
 
     // --- Second consensus run ---
+    // The protocol keeps running, the leader pipelines two blocks without waiting for the first one
     std::cout << std::endl
               << "--- Second consensus run ---" << std::endl;
 
     // Create inputs
     blockchain::Input input41(3001, 10);
     blockchain::Input input42(3002, 8);
+    blockchain::Input input51(3001, 11);
 
     // Create outputs
     blockchain::Output output41(7, 201);
+    blockchain::Output output51(5, 202);
 
     // Create transactions
     blockchain::Transaction transaction4(3006);
     transaction4.addInput(input41);
     transaction4.addInput(input42);
     transaction4.addOutput(output41);
+    blockchain::Transaction transaction5(3007);
+    transaction5.addInput(input51);
+    transaction5.addOutput(output51);
 
     // Create utxolist
     utxolist.clear();
     utxolist.add(blockchain::UTXO(3001, 10, blockchain::Output(4, 201)));
     utxolist.add(blockchain::UTXO(3002, 8, blockchain::Output(3, 201)));
+    utxolist.add(blockchain::UTXO(3001, 11, blockchain::Output(5, 202)));
 
     // add signature
     signature = signature::Signature::getInstance();
@@ -270,85 +268,164 @@ int main() {
     std::vector<std::string> signat4 = signature::Sign(transaction4.getDigest(), signature.getPrivateKey());
     transaction4.setSenderSig(signat4);
     transaction4.setPublicKey(signature.getPublicKey());
+    std::vector<std::string> signat5 = signature::Sign(transaction5.getDigest(), signature.getPrivateKey());
+    transaction5.setSenderSig(signat5);
+    transaction5.setPublicKey(signature.getPublicKey());
 
-    // Create block
+    // Create blocks
     blockchain::Block block2(102, block.getHeader().getID());
     block2.addTransaction(transaction4);
     block2.finalize();
     assert(block2.verify(utxolist, receiverIDs));
+    blockchain::Block block3(103, block2.getHeader().getID());
+    block3.addTransaction(transaction5);
+    block3.finalize();
+    assert(block3.verify(utxolist, receiverIDs));
 
     std::cout << "Updating the nodes" << std::endl;
     nodeLeader.setUTXOlists(utxolist, receiverIDs);
     node1.setUTXOlists(utxolist, receiverIDs);
     node2.setUTXOlists(utxolist, receiverIDs);
 
-    // Running protocol
-    std::cout << "Running protocol" << std::endl;
-    nodeLeader_thread = std::thread(&bracha::LeaderNode::RunProtocol, &nodeLeader, true);
-    node1_thread = std::thread(&bracha::Node::RunProtocol, &node1, true);
-    node2_thread = std::thread(&bracha::Node::RunProtocol, &node2, true);
-    while (nodeLeader.isConsensus() || node1.isConsensus() || node2.isConsensus()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP));
-    }
-    std::cout << "Nodes are not in consensus" << std::endl;
-    assert(!nodeLeader.isConsensus());
-    assert(!node1.isConsensus());
-    assert(!node2.isConsensus());
-    std::cout << "Leader proposes block: " << block2.getHeader().getID().substr(0, 10) << std::endl;
+    // Node 2 takes its blocks from the delivery handler
+    std::mutex delivered_mutex;
+    std::vector<bracha::DeliveredBlock> delivered;
+    node2.setDeliveryHandler([&](bracha::DeliveredBlock&& block) {
+        std::lock_guard<std::mutex> lock(delivered_mutex);
+        delivered.push_back(std::move(block));
+    });
+    auto deliveredCount = [&]() {
+        std::lock_guard<std::mutex> lock(delivered_mutex);
+        return delivered.size();
+    };
+
+    std::cout << "Leader proposes blocks: " << block2.getHeader().getID().substr(0, 10) << ", " << block3.getHeader().getID().substr(0, 10) << std::endl;
     nodeLeader.Propose(block2);
+    nodeLeader.Propose(block3);
     std::cout << "Waiting for consensus" << std::endl;
-    leader_con = false;
-    node1_con = false;
-    node2_con = false;
-    while (!(leader_con && node1_con && node2_con)) {
-        if (nodeLeader.isConsensus() != leader_con) {
-            std::cout << "Leader consensus: " << nodeLeader.isConsensus() << std::endl;
-            leader_con = nodeLeader.isConsensus();
-        }
-        if (node1.isConsensus() != node1_con) {
-            std::cout << "Node1 consensus: " << node1.isConsensus() << std::endl;
-            node1_con = node1.isConsensus();
-        }
-        if (node2.isConsensus() != node2_con) {
-            std::cout << "Node2 consensus: " << node2.isConsensus() << std::endl;
-            node2_con = node2.isConsensus();
-        }
+    while (nodeLeader.getConsensusBlocks().size() < 2 || node1.getConsensusBlocks().size() < 2 || deliveredCount() < 2) {
         std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP));
     }
     std::cout << "All nodes reached consensus" << std::endl;
     voted_hash_leader = nodeLeader.getVotedHash();
     voted_hash_node1 = node1.getVotedHash();
     voted_hash_node2 = node2.getVotedHash();
-    block_hash = block2.getHeader().getID();
+    block_hash = block3.getHeader().getID();
     assert(voted_hash_leader == block_hash);
     assert(voted_hash_node1 == block_hash);
     assert(voted_hash_node2 == block_hash);
     std::cout << "Voted hashes are correct" << std::endl;
-    block_leader = nodeLeader.getReceivedBlock(voted_hash_leader);
-    block_node1 = node1.getReceivedBlock(voted_hash_node1);
-    block_node2 = node2.getReceivedBlock(voted_hash_node2);
-    min_sigs = 1 + floor((n + f + 1) / 2) + 2 * f + 1;
-    assert(block_leader.getValidatorSignatures().size() >= min_sigs);
-    assert(block_node1.getValidatorSignatures().size() >= min_sigs);
-    assert(block_node2.getValidatorSignatures().size() >= min_sigs);
-    std::cout << "All nodes received at least " << min_sigs << " signatures" << std::endl;
-    block2.removeSignatures();
-    block_leader.removeSignatures();
-    block_node1.removeSignatures();
-    block_node2.removeSignatures();
-    assert(block2 == block_leader);
-    assert(block2 == block_node1);
-    assert(block2 == block_node2);
+    assert(node2.getConsensusBlocks().empty());
+    for (bracha::Node* node : std::vector<bracha::Node*>{&nodeLeader, &node1, &node2}) {
+        // Blocks are delivered in the order they were proposed
+        std::vector<blockchain::Block> accepted = node->getConsensusBlocks();
+        if (node == &node2) {
+            accepted = {delivered[0].block, delivered[1].block};
+            assert(delivered[0].instance.proposer == 0 && delivered[0].instance.sequence == 2 && delivered[0].height == 2);
+            assert(delivered[1].instance.proposer == 0 && delivered[1].instance.sequence == 3 && delivered[1].height == 3);
+        }
+        assert(accepted.size() == 2);
+        assert(accepted[0].getCertificate().verify(block2.getHeader().getID(), min_sigs));
+        assert(accepted[1].getCertificate().verify(block3.getHeader().getID(), min_sigs));
+        accepted[0].removeSignatures();
+        accepted[1].removeSignatures();
+        block2.removeSignatures();
+        block3.removeSignatures();
+        assert(accepted[0] == block2);
+        assert(accepted[1] == block3);
+    }
     std::cout << "Received blocks are correct" << std::endl;
-    assert(nodeLeader.getConsensusBlocks().size() == 2);
-    assert(node1.getConsensusBlocks().size() == 2);
-    assert(node2.getConsensusBlocks().size() == 2);
+
+    // Node 2 holds block 3 in full & block 2 as digest & certificate, block 1 is gone
+    bracha::NodeGauges gauges = node2.getGauges();
+    assert(gauges.instances == 0 && gauges.blocks == 1 && gauges.compacted == 1);
+    std::vector<bracha::CompactedBlock> compacted = node2.getCompactedBlocks();
+    assert(compacted[0].height == 2 && compacted[0].hash == block2.getHeader().getID());
+    assert(compacted[0].certificate.verify(compacted[0].hash, min_sigs));
+    std::cout << "Garbage collection is correct" << std::endl;
+
+    // --- Bad coded proposal run ---
+    // The validators echo their fragment before they can verify the block, an invalid block still gets its READY votes.
+    // Its instance is abandoned, so the next proposal of the leader is delivered in its place
+    if (settings.getErasureCoding()) {
+        std::cout << std::endl
+                  << "--- Bad coded proposal run ---" << std::endl;
+        nodeLeader.getConsensusBlocks(true);
+        node1.getConsensusBlocks(true);
+
+        // The leader gets its abandoned block back, e.g. to release the transactions
+        std::vector<std::pair<bracha::InstanceID, blockchain::Block>> abandoned;
+        nodeLeader.setAbandonHandler([&](const bracha::InstanceID& instance, blockchain::Block&& block) {
+            std::lock_guard<std::mutex> lock(delivered_mutex);
+            abandoned.push_back({instance, std::move(block)});
+        });
+        auto abandonedCount = [&]() {
+            std::lock_guard<std::mutex> lock(delivered_mutex);
+            return abandoned.size();
+        };
+
+        // Spends the inputs of transaction 4 twice
+        blockchain::Block bad_block(104, block3.getHeader().getID());
+        bad_block.addTransaction(transaction4);
+        bad_block.addTransaction(transaction4);
+        bad_block.finalize();
+        assert(!bad_block.verify(utxolist, receiverIDs));
+        blockchain::Block block5(105, block3.getHeader().getID());
+        block5.addTransaction(transaction5);
+        block5.finalize();
+        assert(block5.verify(utxolist, receiverIDs));
+
+        std::cout << "Leader proposes blocks: " << bad_block.getHeader().getID().substr(0, 10) << " (invalid), " << block5.getHeader().getID().substr(0, 10) << std::endl;
+        assert(nodeLeader.Propose(bad_block) == 1);
+        assert(nodeLeader.Propose(block5) == 1);
+        std::cout << "Waiting for consensus" << std::endl;
+        while (nodeLeader.getConsensusBlocks().size() < 1 || node1.getConsensusBlocks().size() < 1 || deliveredCount() < 3 || abandonedCount() < 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP));
+        }
+        block_hash = block5.getHeader().getID();
+        assert(nodeLeader.getVotedHash() == block_hash);
+        assert(node1.getVotedHash() == block_hash);
+        assert(node2.getVotedHash() == block_hash);
+        for (bracha::Node* node : std::vector<bracha::Node*>{&nodeLeader, &node1}) {
+            std::vector<blockchain::Block> accepted = node->getConsensusBlocks();
+            assert(accepted.size() == 1);
+            assert(accepted[0].getHeader().getID() == block_hash);
+        }
+        {
+            std::lock_guard<std::mutex> lock(delivered_mutex);
+            assert(delivered.size() == 3);
+            assert(delivered[2].instance.proposer == 0 && delivered[2].instance.sequence == 5 && delivered[2].height == 4);
+            assert(delivered[2].block.getHeader().getID() == block_hash);
+            assert(abandoned.size() == 1);
+            assert(abandoned[0].first.proposer == 0 && abandoned[0].first.sequence == 4);
+            assert(abandoned[0].second.getHeader().getID() == bad_block.getHeader().getID());
+        }
+        nodeLeader.setAbandonHandler(nullptr);
+        assert(node2.getGauges().instances == 0);
+        assert(node2.getReceivedBlock(bad_block.getHeader().getID()).getTransactions().empty());
+        std::cout << "Bad coded proposal was abandoned" << std::endl;
+    }
 
     // Closing threads
+    nodeLeader.Stop();
+    node1.Stop();
+    node2.Stop();
     nodeLeader_thread.join();
     node1_thread.join();
     node2_thread.join();
 
+    // Copy nodes
+    std::cout << "Copying nodes" << std::endl;
+    bracha::LeaderNode nodeLeader_copy2(nodeLeader);
+    bracha::Node node1_copy2(node1);
+    std::cout << "Nodes copied" << std::endl;
+
+    // Move nodes
+    std::cout << "Moving nodes" << std::endl;
+    bracha::LeaderNode nodeLeader_move2(std::move(nodeLeader_copy2));
+    bracha::Node node1_move2(std::move(node1_copy2));
+    std::cout << "Nodes moved" << std::endl;
+
     // // --- Faulty consensus run ---                      uncomment this part to simulate a faulty node but then the tests will not succeed
     // std::cout << std::endl
     //           << "--- Faulty consensus run ---" << std::endl;
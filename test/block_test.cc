@@ -239,6 +239,18 @@ TEST(BlockTest, StringConvert) {
     EXPECT_EQ(block_sig, block.getValidatorSignatures()[0]);
     EXPECT_EQ(1, rec_block.getValidatorSignatures().size());
     EXPECT_EQ(block_sig, rec_block.getValidatorSignatures()[0]);
+
+    // Signatures stored before quorum certificates can't be verified & are dropped
+    json j_legacy = json::parse(str_block);
+    j_legacy.erase("certificate");
+    j_legacy["validatorSigs"].push_back({{"validator_id", block_sig.validator_id},
+                                         {"signature", signature::signature_to_json(block_sig.signature)},
+                                         {"round", block_sig.round},
+                                         {"public_key", signature::SigKey_to_string(block_sig.public_key)}});
+    blockchain::Block legacy_block;
+    legacy_block.from_string(j_legacy.dump());
+    EXPECT_EQ(2, legacy_block.getID());
+    EXPECT_TRUE(legacy_block.getValidatorSignatures().empty());
 }
 
 TEST(BlockTest, VerifyValid) {
@@ -0,0 +1,122 @@
+#include "blockchain/certificate.h"
+
+#include <gtest/gtest.h>
+
+#include "blockchain/block.h"
+#include "signature/hash.h"
+
+// Signs the block hash like a validator does in a vote
+blockchain::BlockSignature sign_hash(const std::string& block_hash, uint16_t validator_id, uint16_t round) {
+    signature::Signature key = signature::Signature::getInstance();
+    key.KeyGen();
+    signature::SigKey public_key = key.getPublicKey();
+    signature::SigKey private_key = key.getPrivateKey();
+    key.KeyGen();
+    std::string next_key_hash = blockchain::Block::keyHash(key.getPublicKey());
+
+    blockchain::BlockSignature sig;
+    sig.validator_id = validator_id;
+    sig.round = round;
+    sig.next_key_hash = next_key_hash;
+    sig.public_key = public_key;
+    sig.signature = signature::Sign(blockchain::Block::signingDigest(block_hash, validator_id, next_key_hash), private_key);
+    return sig;
+}
+
+TEST(CertificateTest, OneSignaturePerValidator) {
+    std::string block_hash = signature::hash("block");
+    blockchain::QuorumCertificate cert;
+    EXPECT_TRUE(cert.empty());
+
+    blockchain::BlockSignature echo = sign_hash(block_hash, 1, 1);
+    blockchain::BlockSignature ready = sign_hash(block_hash, 1, 2);
+    EXPECT_TRUE(cert.add(echo));
+    EXPECT_FALSE(cert.add(echo));
+    // READY replaces the ECHO of the same validator
+    EXPECT_TRUE(cert.add(ready));
+    EXPECT_FALSE(cert.add(echo));
+    EXPECT_EQ(1, cert.size());
+    EXPECT_EQ(ready, cert.getSignatures()[0]);
+
+    // A signature with a known key replaces one without
+    blockchain::BlockSignature unknown = sign_hash(block_hash, 3, 2);
+    unknown.public_key = signature::SigKey();
+    EXPECT_TRUE(cert.add(unknown));
+    EXPECT_FALSE(cert.add(unknown));
+    blockchain::BlockSignature known = sign_hash(block_hash, 3, 1);
+    EXPECT_TRUE(cert.add(known));
+
+    EXPECT_EQ(2, cert.size());
+    EXPECT_TRUE(cert.hasSigned(1));
+    EXPECT_TRUE(cert.hasSigned(3));
+    EXPECT_FALSE(cert.hasSigned(2));
+
+    // Malformed signatures are ignored
+    blockchain::BlockSignature malformed = sign_hash(block_hash, 4, 1);
+    malformed.signature.pop_back();
+    EXPECT_FALSE(cert.add(malformed));
+
+    // Preimages that don't belong to the public key are ignored
+    blockchain::BlockSignature foreign = sign_hash(block_hash, 4, 1);
+    foreign.public_key = sign_hash(block_hash, 4, 1).public_key;
+    EXPECT_FALSE(cert.add(foreign));
+    EXPECT_FALSE(cert.hasSigned(4));
+}
+
+TEST(CertificateTest, Verify) {
+    std::string block_hash = signature::hash("block");
+    blockchain::QuorumCertificate cert;
+    for (uint16_t i = 0; i < 4; i++) {
+        cert.add(sign_hash(block_hash, i, 2));
+    }
+    EXPECT_EQ(4, cert.verify(block_hash));
+    EXPECT_TRUE(cert.verify(block_hash, 3));
+    EXPECT_EQ(0, cert.verify(signature::hash("other block")));
+
+    // Signature of another block does not count
+    cert.add(sign_hash(signature::hash("other block"), 5, 2));
+    EXPECT_EQ(5, cert.size());
+    EXPECT_EQ(4, cert.verify(block_hash));
+    EXPECT_FALSE(cert.verify(block_hash, 5));
+}
+
+TEST(CertificateTest, VerifyLargeCertificate) {
+    // Enough signers to spread the check over threads, one of them signed another block
+    std::string block_hash = signature::hash("block");
+    blockchain::QuorumCertificate cert;
+    for (uint16_t i = 0; i < PARALLEL_VERIFY_SIGNERS_; i++) {
+        cert.add(sign_hash(i == 3 ? signature::hash("other block") : block_hash, i, 2));
+    }
+    EXPECT_EQ(PARALLEL_VERIFY_SIGNERS_ - 1, cert.verify(block_hash));
+    EXPECT_TRUE(cert.verify(block_hash, PARALLEL_VERIFY_SIGNERS_ - 1));
+    EXPECT_FALSE(cert.verify(block_hash, PARALLEL_VERIFY_SIGNERS_));
+}
+
+TEST(CertificateTest, JsonConvert) {
+    std::string block_hash = signature::hash("block");
+    blockchain::QuorumCertificate cert;
+    cert.add(sign_hash(block_hash, 0, 2));
+    cert.add(sign_hash(block_hash, 7, 3));
+    blockchain::BlockSignature unknown = sign_hash(block_hash, 2, 1);
+    unknown.public_key = signature::SigKey();
+    cert.add(unknown);
+
+    json j = cert.to_json();
+    EXPECT_EQ(3, j.at("signatures").size());
+    // Only the unrevealed half of a known key is stored
+    EXPECT_EQ(KEY_LEN_ * blockchain::Block::keyHash(cert.getSignatures()[0].public_key).size(), j.at("signatures")[0].at("unrevealed").get<std::string>().size());
+    EXPECT_FALSE(j.at("signatures")[1].contains("unrevealed"));
+
+    blockchain::QuorumCertificate rec_cert;
+    rec_cert.from_json(json::parse(j.dump()));
+    EXPECT_TRUE(cert == rec_cert);
+    EXPECT_EQ(cert.getSigners(), rec_cert.getSigners());
+    EXPECT_EQ(2, rec_cert.verify(block_hash));
+
+    // A key that doesn't hash to the announced key hash does not count
+    std::string unrevealed = j["signatures"][0]["unrevealed"];
+    unrevealed[0] = unrevealed[0] == '0' ? '1' : '0';
+    j["signatures"][0]["unrevealed"] = unrevealed;
+    rec_cert.from_json(json::parse(j.dump()));
+    EXPECT_EQ(1, rec_cert.verify(block_hash));
+}
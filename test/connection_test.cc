@@ -0,0 +1,48 @@
+#include "comms/connection.h"
+
+#include <gtest/gtest.h>
+
+TEST(ConnectionTest, CachesStubs) {
+    comms::ConnectionManager connections;
+    EXPECT_EQ(connections.size(), 0);
+
+    std::shared_ptr<chat::Chat::Stub> stub1 = connections.getStub("localhost:50100");
+    std::shared_ptr<chat::Chat::Stub> stub2 = connections.getStub("localhost:50101");
+    ASSERT_NE(stub1, nullptr);
+    ASSERT_NE(stub2, nullptr);
+    EXPECT_NE(stub1, stub2);
+
+    // The same address reuses the channel & stub
+    EXPECT_EQ(connections.getStub("localhost:50100"), stub1);
+    EXPECT_EQ(connections.size(), 2);
+
+    // The generic stub shares the channel
+    std::shared_ptr<grpc::GenericStub> generic = connections.getGenericStub("localhost:50100");
+    ASSERT_NE(generic, nullptr);
+    EXPECT_EQ(connections.getGenericStub("localhost:50100"), generic);
+    EXPECT_EQ(connections.size(), 2);
+}
+
+TEST(ConnectionTest, Metrics) {
+    config::Settings settings({}, 0, {}, 0, 0);
+    settings.setKeepalive(1000, 500);
+    settings.setReconnectBackoff(50, 200);
+    comms::ConnectionManager connections(settings);
+
+    EXPECT_EQ(connections.getState("localhost:50100"), GRPC_CHANNEL_SHUTDOWN);
+    connections.getStub("localhost:50100");
+    // Channels connect lazily on the first RPC
+    EXPECT_EQ(connections.getState("localhost:50100"), GRPC_CHANNEL_IDLE);
+
+    connections.recordResult("localhost:50100", grpc::Status::OK);
+    connections.recordResult("localhost:50100", grpc::Status(grpc::StatusCode::UNAVAILABLE, "down"));
+    connections.recordResult("localhost:50100", grpc::Status::OK);
+    // Results of unknown addresses are ignored
+    connections.recordResult("localhost:50200", grpc::Status::OK);
+
+    std::vector<comms::ChannelMetrics> metrics = connections.getMetrics();
+    ASSERT_EQ(metrics.size(), 1);
+    EXPECT_EQ(metrics[0].address, "localhost:50100");
+    EXPECT_EQ(metrics[0].rpcs, 3);
+    EXPECT_EQ(metrics[0].failures, 1);
+}
@@ -0,0 +1,59 @@
+#include "comms/decode_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST(DecodePoolTest, RunsAllTasks) {
+    std::atomic<int> done{0};
+    {
+        comms::DecodePool pool(3);
+        EXPECT_EQ(pool.getNumberOfThreads(), 3);
+        for (int i = 0; i < 1000; i++) {
+            pool.Submit(i, [&done]() { done++; });
+        }
+        // Stop() runs the queued tasks before it returns
+        pool.Stop();
+        EXPECT_EQ(done, 1000);
+    }
+
+    // A stopped pool runs tasks in the calling thread
+    comms::DecodePool pool(1);
+    pool.Stop();
+    pool.Submit(0, [&done]() { done++; });
+    EXPECT_EQ(done, 1001);
+}
+
+TEST(DecodePoolTest, KeepsOrderPerKey) {
+    const int keys = 4;
+    const int per_key = 2000;
+    std::vector<std::vector<int>> seen(keys);
+    std::mutex seen_mutex;
+
+    comms::DecodePool pool(2);
+    std::vector<std::thread> producers;
+    for (int k = 0; k < keys; k++) {
+        producers.emplace_back([&, k]() {
+            for (int i = 0; i < per_key; i++) {
+                pool.Submit(k, [&, k, i]() {
+                    std::lock_guard<std::mutex> lock(seen_mutex);
+                    seen[k].push_back(i);
+                });
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    pool.Stop();
+
+    for (int k = 0; k < keys; k++) {
+        ASSERT_EQ(seen[k].size(), per_key);
+        for (int i = 0; i < per_key; i++) {
+            EXPECT_EQ(seen[k][i], i);
+        }
+    }
+}
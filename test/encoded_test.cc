@@ -0,0 +1,57 @@
+#include "comms/encoded.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+// Big enough to be shared, gRPC copies tiny slices inline
+blockchain::Message makeMessage(blockchain::MsgType type, uint32_t sender_id, uint64_t sequence) {
+    blockchain::Block block(2, std::string(64, 'a'));
+    block.finalize();
+    return blockchain::Message(type, block, sender_id, 1, 0, sequence);
+}
+
+std::string concat(const std::vector<grpc::Slice>& slices) {
+    std::string bytes;
+    for (const grpc::Slice& slice : slices) {
+        bytes.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+    }
+    return bytes;
+}
+}  // namespace
+
+TEST(EncodedTest, ParsesAsSendBatch) {
+    blockchain::Message message1 = makeMessage(blockchain::MsgType::ECHO, 3, 11);
+    blockchain::Message message2 = makeMessage(blockchain::MsgType::READY, 4, 12);
+    comms::EncodedMessage encoded1(message1);
+    comms::EncodedMessage encoded2(message2);
+    EXPECT_EQ(encoded1.size(), message1.toProtoMessage().ByteSizeLong());
+
+    std::vector<grpc::Slice> slices;
+    encoded1.appendSend(7, 1, slices);
+    encoded2.appendSend(7, 300, slices);
+
+    chat::SendBatch batch;
+    ASSERT_TRUE(batch.ParseFromString(concat(slices)));
+    ASSERT_EQ(batch.sends_size(), 2);
+    EXPECT_EQ(batch.sends(0).session(), 7);
+    EXPECT_EQ(batch.sends(0).seq(), 1);
+    EXPECT_EQ(batch.sends(1).seq(), 300);
+    EXPECT_EQ(batch.sends(0).message().SerializeAsString(), message1.toProtoMessage().SerializeAsString());
+    EXPECT_EQ(blockchain::Message(batch.sends(1).message()).getSequence(), 12);
+}
+
+TEST(EncodedTest, SharesBytes) {
+    blockchain::Message message = makeMessage(blockchain::MsgType::ECHO, 1, 1);
+    comms::EncodedMessage encoded(message);
+    comms::EncodedMessage copy = encoded;
+
+    std::vector<grpc::Slice> slices1;
+    std::vector<grpc::Slice> slices2;
+    encoded.appendSend(1, 1, slices1);
+    copy.appendSend(2, 1, slices2);
+
+    // Every frame points to the same message bytes
+    ASSERT_EQ(slices1.size(), 3);
+    ASSERT_EQ(slices2.size(), 3);
+    EXPECT_EQ(slices1[1].begin(), slices2[1].begin());
+}
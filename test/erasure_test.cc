@@ -0,0 +1,65 @@
+#include "bracha/erasure.h"
+
+#include <gtest/gtest.h>
+
+TEST(ErasureTest, Systematic) {
+    bracha::ErasureCode code(2, 4);
+    EXPECT_EQ(2, code.getDataFragments());
+    EXPECT_EQ(4, code.getTotalFragments());
+
+    std::string data = "some block data that gets split";
+    std::vector<std::string> fragments = code.encode(data);
+    ASSERT_EQ(4, fragments.size());
+    for (const std::string& fragment : fragments) {
+        EXPECT_EQ(fragments[0].size(), fragment.size());
+    }
+    // The data fragments hold the length prefixed data
+    EXPECT_EQ(data, (fragments[0] + fragments[1]).substr(8, data.size()));
+}
+
+TEST(ErasureTest, DecodeAnySubset) {
+    bracha::ErasureCode code(3, 7);
+    std::string data;
+    for (int i = 0; i < 1000; i++) {
+        data.push_back(static_cast<char>(i * 37 % 256));
+    }
+    std::vector<std::string> fragments = code.encode(data);
+
+    // Every combination of 3 fragments gives back the data
+    for (uint16_t a = 0; a < 7; a++) {
+        for (uint16_t b = a + 1; b < 7; b++) {
+            for (uint16_t c = b + 1; c < 7; c++) {
+                std::map<uint16_t, std::string> subset{{a, fragments[a]}, {b, fragments[b]}, {c, fragments[c]}};
+                std::string decoded;
+                ASSERT_TRUE(code.decode(subset, decoded));
+                EXPECT_EQ(data, decoded);
+            }
+        }
+    }
+}
+
+TEST(ErasureTest, EmptyData) {
+    bracha::ErasureCode code(2, 4);
+    std::vector<std::string> fragments = code.encode("");
+    std::string decoded = "not empty";
+    EXPECT_TRUE(code.decode({{1, fragments[1]}, {3, fragments[3]}}, decoded));
+    EXPECT_EQ("", decoded);
+}
+
+TEST(ErasureTest, NotEnoughFragments) {
+    bracha::ErasureCode code(3, 4);
+    std::vector<std::string> fragments = code.encode("data");
+    std::string decoded;
+    EXPECT_FALSE(code.decode({{0, fragments[0]}, {2, fragments[2]}}, decoded));
+    // Fragments of different sizes are malformed
+    EXPECT_FALSE(code.decode({{0, fragments[0]}, {1, fragments[1]}, {2, fragments[2] + "x"}}, decoded));
+    // Unknown indices are ignored
+    EXPECT_FALSE(code.decode({{0, fragments[0]}, {1, fragments[1]}, {9, fragments[2]}}, decoded));
+}
+
+TEST(ErasureTest, InvalidParameters) {
+    EXPECT_THROW(bracha::ErasureCode(0, 4), std::invalid_argument);
+    EXPECT_THROW(bracha::ErasureCode(5, 4), std::invalid_argument);
+    EXPECT_THROW(bracha::ErasureCode(2, MAX_FRAGMENTS_ + 1), std::invalid_argument);
+    EXPECT_NO_THROW(bracha::ErasureCode(1, 1));
+}
@@ -0,0 +1,113 @@
+#include "cryptowallet/event_handler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST(EventHandlerTest, RunsSubscribersPerEvent) {
+    std::atomic<int> proposed{0};
+    std::atomic<int> stored{0};
+    {
+        cryptowallet::EventHandler handler;
+        EXPECT_EQ(handler.getNumberOfThreads(), 1);
+        EXPECT_NE(handler.SubscriberEvent(cryptowallet::Event::PROPOSE, [&proposed]() { proposed++; }), 0);
+        EXPECT_NE(handler.SubscriberEvent(cryptowallet::Event::DBSTORE, [&stored]() { stored++; }), 0);
+        for (int i = 0; i < 100; i++) {
+            handler.PublishEvent(cryptowallet::Event::PROPOSE);
+        }
+        handler.PublishEvent(cryptowallet::Event::DBSTORE);
+        handler.PublishEvent(cryptowallet::Event::SYNC);
+
+        // Stop() runs the published events before it returns
+        handler.Stop();
+        EXPECT_EQ(proposed, 100);
+        EXPECT_EQ(stored, 1);
+
+        handler.PublishEvent(cryptowallet::Event::PROPOSE);
+    }
+    EXPECT_EQ(proposed, 100);
+}
+
+TEST(EventHandlerTest, RunsTasksOnce) {
+    std::atomic<int> tasks{0};
+    std::atomic<int> published{0};
+
+    cryptowallet::EventHandler handler;
+    handler.SubscriberEvent(cryptowallet::Event::PROPOSE, [&published]() { published++; });
+    for (int i = 0; i < 10; i++) {
+        handler.PostTask(cryptowallet::Event::PROPOSE, [&tasks]() { tasks++; });
+        handler.PublishEvent(cryptowallet::Event::PROPOSE);
+    }
+    handler.Stop();
+
+    // Neither earlier tasks nor subscribers pile up
+    EXPECT_EQ(tasks, 10);
+    EXPECT_EQ(published, 10);
+
+    handler.PostTask(cryptowallet::Event::PROPOSE, [&tasks]() { tasks++; });
+    EXPECT_EQ(tasks, 10);
+}
+
+TEST(EventHandlerTest, BoundsSubscriptions) {
+    cryptowallet::EventHandler handler;
+    std::vector<cryptowallet::EventHandler::SubscriptionId> ids;
+    for (int i = 0; i < EVENT_MAX_SUBSCRIBERS_; i++) {
+        ids.push_back(handler.SubscriberEvent(cryptowallet::Event::DBSTORE, []() {}));
+        EXPECT_NE(ids.back(), 0);
+    }
+    EXPECT_EQ(handler.SubscriberEvent(cryptowallet::Event::DBSTORE, []() {}), 0);
+    // Other event types have their own limit
+    EXPECT_NE(handler.SubscriberEvent(cryptowallet::Event::PROPOSE, []() {}), 0);
+
+    EXPECT_TRUE(handler.releaseSubscriberEvent(cryptowallet::Event::DBSTORE, ids[3]));
+    EXPECT_FALSE(handler.releaseSubscriberEvent(cryptowallet::Event::DBSTORE, ids[3]));
+    EXPECT_FALSE(handler.releaseSubscriberEvent(cryptowallet::Event::PROPOSE, ids[4]));
+    EXPECT_NE(handler.SubscriberEvent(cryptowallet::Event::DBSTORE, []() {}), 0);
+}
+
+TEST(EventHandlerTest, KeepsOrderPerEvent) {
+    std::vector<int> seen;
+    std::atomic<int> other{0};
+
+    cryptowallet::EventHandler handler(3);
+    EXPECT_EQ(handler.getNumberOfThreads(), 3);
+    for (int i = 0; i < 500; i++) {
+        // Tasks may post tasks themselves
+        handler.PostTask(cryptowallet::Event::PROPOSE, [&, i]() {
+            seen.push_back(i);
+            handler.PostTask(cryptowallet::Event::DBSTORE, [&other]() { other++; });
+        });
+    }
+    // Tasks posted after Stop() would be dropped
+    for (int i = 0; i < 1000 && other < 500; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    handler.Stop();
+
+    ASSERT_EQ(seen.size(), 500);
+    for (int i = 0; i < 500; i++) {
+        EXPECT_EQ(seen[i], i);
+    }
+    EXPECT_EQ(other, 500);
+}
+
+TEST(EventHandlerTest, SpreadsEventTypes) {
+    std::atomic<bool> stored{false};
+    bool waited = false;
+
+    // PROPOSE & DBSTORE get a worker each, a blocked proposal doesn't hold back the stored blocks
+    cryptowallet::EventHandler handler(2);
+    handler.PostTask(cryptowallet::Event::PROPOSE, [&]() {
+        for (int i = 0; i < 1000 && !stored; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        waited = stored;
+    });
+    handler.PostTask(cryptowallet::Event::DBSTORE, [&stored]() { stored = true; });
+    handler.Stop();
+
+    EXPECT_TRUE(waited);
+}
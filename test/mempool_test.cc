@@ -0,0 +1,181 @@
+#include "cryptowallet/mempool.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+blockchain::Transaction makeTx(uint16_t sender_id, uint32_t tx_id, std::vector<blockchain::Input> inputs) {
+    blockchain::Transaction tx(tx_id, sender_id);
+    for (const blockchain::Input& input : inputs) {
+        tx.addInput(input);
+    }
+    return tx;
+}
+
+std::vector<uint32_t> ids(const std::vector<blockchain::Transaction>& txs) {
+    std::vector<uint32_t> result;
+    for (const auto& tx : txs) {
+        result.push_back(tx.getID());
+    }
+    return result;
+}
+}  // namespace
+
+TEST(MempoolTest, OldestFirst) {
+    cryptowallet::Mempool pool;
+    EXPECT_EQ(pool.add(makeTx(1, 10, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.add(makeTx(2, 20, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.add(makeTx(1, 30, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.size(), 3);
+
+    EXPECT_EQ(ids(pool.take(2)), std::vector<uint32_t>({10, 20}));
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({30}));
+    EXPECT_EQ(pool.pending(), 0);
+
+    // Taken transactions are held until their block is delivered
+    EXPECT_EQ(pool.size(), 3);
+    EXPECT_EQ(pool.removeIncluded({makeTx(1, 10, {}), makeTx(2, 20, {}), makeTx(1, 30, {})}), 3);
+    EXPECT_EQ(pool.size(), 0);
+    EXPECT_EQ(pool.bytes(), 0);
+}
+
+TEST(MempoolTest, InFlight) {
+    cryptowallet::Mempool pool;
+    blockchain::Transaction proposed = makeTx(1, 10, {blockchain::Input(1, 0)});
+    pool.add(proposed);
+    pool.add(makeTx(1, 11, {}));
+    EXPECT_EQ(ids(pool.take(1)), std::vector<uint32_t>({10}));
+
+    // A resent copy & a double spend of a proposed transaction are not pooled while its block is pending
+    EXPECT_TRUE(pool.contains(1, 10));
+    EXPECT_EQ(pool.add(proposed), cryptowallet::Mempool::AddResult::DUPLICATE);
+    EXPECT_EQ(pool.add(makeTx(1, 12, {blockchain::Input(1, 0)})), cryptowallet::Mempool::AddResult::CONFLICT);
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({11}));
+
+    // The transactions of a dropped block are taken first again
+    pool.add(makeTx(1, 13, {}));
+    EXPECT_EQ(pool.release({proposed}), 1);
+    EXPECT_EQ(pool.release({proposed}), 0);
+    EXPECT_EQ(pool.pending(), 2);
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({10, 13}));
+}
+
+TEST(MempoolTest, Duplicates) {
+    cryptowallet::Mempool pool;
+    EXPECT_EQ(pool.add(makeTx(1, 10, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.add(makeTx(1, 10, {})), cryptowallet::Mempool::AddResult::DUPLICATE);
+    // Tx ids are only unique per wallet
+    EXPECT_EQ(pool.add(makeTx(2, 10, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_TRUE(pool.contains(1, 10));
+    EXPECT_TRUE(pool.contains(2, 10));
+    EXPECT_FALSE(pool.contains(3, 10));
+
+    EXPECT_TRUE(pool.remove(1, 10));
+    EXPECT_FALSE(pool.remove(1, 10));
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({10}));
+}
+
+TEST(MempoolTest, Capacity) {
+    cryptowallet::Mempool pool(2);
+    EXPECT_EQ(pool.add(makeTx(1, 1, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.add(makeTx(1, 2, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(pool.add(makeTx(1, 3, {})), cryptowallet::Mempool::AddResult::FULL);
+
+    cryptowallet::Mempool small(10, pool.bytes() / 2 + 1);
+    EXPECT_EQ(small.add(makeTx(1, 1, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(small.add(makeTx(1, 2, {})), cryptowallet::Mempool::AddResult::FULL);
+}
+
+TEST(MempoolTest, Eviction) {
+    cryptowallet::Mempool pool(4);
+    pool.add(makeTx(1, 1, {}));
+    pool.add(makeTx(1, 2, {}));
+    pool.add(makeTx(1, 3, {}));
+    pool.add(makeTx(2, 1, {}));
+    EXPECT_EQ(ids(pool.take(1)), std::vector<uint32_t>({1}));
+
+    // The newest pending transaction of the most loaded wallet makes room
+    EXPECT_EQ(pool.add(makeTx(3, 1, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_FALSE(pool.contains(1, 3));
+    EXPECT_EQ(pool.evicted(), 1);
+
+    // Wallet 1 would hold fewer pending transactions than wallet 3, the in flight one is not evicted
+    EXPECT_EQ(pool.check(makeTx(3, 2, {})), cryptowallet::Mempool::AddResult::FULL);
+    EXPECT_EQ(pool.add(makeTx(3, 2, {})), cryptowallet::Mempool::AddResult::FULL);
+    EXPECT_EQ(pool.add(makeTx(1, 4, {})), cryptowallet::Mempool::AddResult::FULL);
+    EXPECT_EQ(pool.size(), 4);
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({2, 1, 1}));
+
+    // The memory cap evicts the same way
+    cryptowallet::Mempool small(10, pool.bytes() / 2);
+    small.add(makeTx(1, 1, {}));
+    small.add(makeTx(1, 2, {}));
+    EXPECT_EQ(small.add(makeTx(2, 1, {})), cryptowallet::Mempool::AddResult::ADDED);
+    EXPECT_EQ(small.evicted(), 1);
+    EXPECT_EQ(ids(small.take()), std::vector<uint32_t>({1, 1}));
+}
+
+TEST(MempoolTest, RemoveIncluded) {
+    cryptowallet::Mempool pool;
+    pool.add(makeTx(1, 10, {blockchain::Input(1, 0)}));
+    pool.add(makeTx(1, 11, {blockchain::Input(2, 0)}));
+    pool.add(makeTx(2, 20, {blockchain::Input(1, 0)}));
+
+    // The block holds tx 10 & another transaction of wallet 1 spending output (2, 0)
+    std::vector<blockchain::Transaction> block_txs = {makeTx(1, 10, {blockchain::Input(1, 0)}),
+                                                      makeTx(1, 12, {blockchain::Input(2, 0)})};
+    EXPECT_EQ(pool.removeIncluded(block_txs), 2);
+
+    // Output (1, 0) of wallet 2 is a different output
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({20}));
+}
+
+TEST(MempoolTest, Conflicts) {
+    cryptowallet::Mempool pool;
+    blockchain::Transaction first = makeTx(1, 10, {blockchain::Input(1, 0), blockchain::Input(1, 1)});
+    // An older transaction of the wallet cannot replace the pooled one
+    blockchain::Transaction second = makeTx(1, 9, {blockchain::Input(1, 1)});
+    EXPECT_FALSE(pool.conflicts(first));
+    EXPECT_EQ(pool.add(first), cryptowallet::Mempool::AddResult::ADDED);
+
+    // A pooled transaction does not conflict with itself
+    EXPECT_FALSE(pool.conflicts(first));
+    EXPECT_TRUE(pool.conflicts(second));
+    EXPECT_EQ(pool.add(second), cryptowallet::Mempool::AddResult::CONFLICT);
+    EXPECT_EQ(pool.size(), 1);
+
+    // Outputs are per wallet
+    EXPECT_EQ(pool.add(makeTx(2, 11, {blockchain::Input(1, 1)})), cryptowallet::Mempool::AddResult::ADDED);
+
+    // The output is free again once the first transaction left the pool
+    EXPECT_TRUE(pool.remove(1, 10));
+    EXPECT_EQ(pool.add(second), cryptowallet::Mempool::AddResult::ADDED);
+}
+
+TEST(MempoolTest, Replacement) {
+    cryptowallet::Mempool pool;
+    pool.add(makeTx(1, 10, {blockchain::Input(1, 0), blockchain::Input(1, 1)}));
+    pool.add(makeTx(1, 11, {blockchain::Input(1, 2)}));
+    pool.add(makeTx(1, 20, {}));
+
+    // A newer transaction of the wallet replaces every pending transaction it conflicts with
+    blockchain::Transaction newer = makeTx(1, 30, {blockchain::Input(1, 1), blockchain::Input(1, 2)});
+    EXPECT_FALSE(pool.conflicts(newer));
+    EXPECT_EQ(pool.add(newer), cryptowallet::Mempool::AddResult::REPLACED);
+    EXPECT_FALSE(pool.contains(1, 10));
+    EXPECT_FALSE(pool.contains(1, 11));
+    EXPECT_EQ(pool.size(), 2);
+
+    // Proposed transactions are not replaced
+    EXPECT_EQ(ids(pool.take()), std::vector<uint32_t>({20, 30}));
+    blockchain::Transaction newest = makeTx(1, 40, {blockchain::Input(1, 1)});
+    EXPECT_TRUE(pool.conflicts(newest));
+    EXPECT_EQ(pool.add(newest), cryptowallet::Mempool::AddResult::CONFLICT);
+
+    // A replacement fits in the space it frees
+    cryptowallet::Mempool full(1);
+    full.add(makeTx(1, 10, {blockchain::Input(1, 0)}));
+    EXPECT_EQ(full.check(makeTx(1, 11, {blockchain::Input(1, 0)})), cryptowallet::Mempool::AddResult::REPLACED);
+    EXPECT_TRUE(full.contains(1, 10));
+    EXPECT_EQ(full.add(makeTx(1, 11, {blockchain::Input(1, 0)})), cryptowallet::Mempool::AddResult::REPLACED);
+    EXPECT_EQ(full.add(makeTx(1, 12, {})), cryptowallet::Mempool::AddResult::FULL);
+}
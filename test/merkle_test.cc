@@ -0,0 +1,34 @@
+#include "bracha/merkle.h"
+
+#include <gtest/gtest.h>
+
+TEST(MerkleTest, Proofs) {
+    std::vector<std::string> leaves{"fragment0", "fragment1", "fragment2", "fragment3", "fragment4"};
+    bracha::MerkleTree tree(leaves);
+    EXPECT_EQ(5, tree.size());
+
+    for (size_t i = 0; i < leaves.size(); i++) {
+        std::vector<std::string> proof = tree.getProof(i);
+        EXPECT_EQ(3, proof.size());
+        EXPECT_TRUE(bracha::MerkleTree::verify(tree.getRoot(), i, leaves[i], proof));
+        // Wrong leaf or wrong position
+        EXPECT_FALSE(bracha::MerkleTree::verify(tree.getRoot(), i, "other", proof));
+        EXPECT_FALSE(bracha::MerkleTree::verify(tree.getRoot(), (i + 1) % leaves.size(), leaves[i], proof));
+    }
+    EXPECT_THROW(tree.getProof(5), std::out_of_range);
+}
+
+TEST(MerkleTest, Root) {
+    bracha::MerkleTree tree1({"a", "b", "c"});
+    bracha::MerkleTree tree2({"a", "b", "c"});
+    bracha::MerkleTree tree3({"a", "b", "d"});
+    EXPECT_EQ(tree1.getRoot(), tree2.getRoot());
+    EXPECT_NE(tree1.getRoot(), tree3.getRoot());
+
+    // A single leaf is its own root
+    bracha::MerkleTree tree4({"a"});
+    EXPECT_EQ(signature::hash("a"), tree4.getRoot());
+    EXPECT_TRUE(bracha::MerkleTree::verify(tree4.getRoot(), 0, "a", tree4.getProof(0)));
+
+    EXPECT_THROW(bracha::MerkleTree({}), std::invalid_argument);
+}
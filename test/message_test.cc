@@ -119,4 +119,62 @@ TEST(MessageTest, ProtoConvert) {
     EXPECT_EQ(1002, msg_block_rec.getSenderId());
     EXPECT_EQ(1, msg_block_rec.getRound());
     EXPECT_FALSE(msg_block_rec.isEmpty());
+
+    // Instance of the message
+    blockchain::Message messageInstance(blockchain::MsgType::READY, block, 1002, 2, 3, 42);
+    blockchain::Message msg_instance_rec(messageInstance.toProtoMessage());
+    EXPECT_EQ(blockchain::MsgType::READY, msg_instance_rec.getType());
+    EXPECT_EQ(3, msg_instance_rec.getProposerId());
+    EXPECT_EQ(42, msg_instance_rec.getSequence());
+    EXPECT_EQ(0, msg_block_rec.getProposerId());
+    EXPECT_EQ(0, msg_block_rec.getSequence());
+}
+
+TEST(MessageTest, SkipsKnownBlock) {
+    // Create transaction
+    blockchain::Transaction transaction(3001);
+    transaction.addInput(blockchain::Input(2001, 10));
+    transaction.addOutput(blockchain::Output(6, 1001));
+    signature::Signature signature = signature::Signature::getInstance();
+    signature.KeyGen();
+    transaction.setSenderSig(signature::Sign(transaction.getDigest(), signature.getPrivateKey()));
+    transaction.setPublicKey(signature.getPublicKey());
+
+    // Create & sign block
+    blockchain::Block block(2, "prevblock");
+    block.addTransaction(transaction);
+    block.finalize();
+    signature::Signature signature1 = signature::Signature::getInstance();
+    signature::Signature signature2 = signature::Signature::getInstance();
+    signature1.KeyGen();
+    signature2.KeyGen();
+    block.sign(signature1.getPrivateKey(), 26, signature2.getPublicKey());
+    std::string blk_hash = block.getHeader().getID();
+    chat::Message proto_msg = blockchain::Message(blockchain::MsgType::SEND, block, 1002, 1, 26, 7).toProtoMessage();
+
+    // An unknown block is decoded in full
+    blockchain::Message msg_unknown(proto_msg, [](const std::string&) { return false; });
+    EXPECT_FALSE(msg_unknown.hasKnownBlock());
+    EXPECT_FALSE(msg_unknown.isVote());
+    EXPECT_EQ(block, msg_unknown.getBlock());
+
+    // A known block is read as the vote of its signer
+    std::string looked_up;
+    blockchain::Message msg_known(proto_msg, [&](const std::string& hash) {
+        looked_up = hash;
+        return true;
+    });
+    EXPECT_EQ(blk_hash, looked_up);
+    EXPECT_TRUE(msg_known.hasKnownBlock());
+    EXPECT_TRUE(msg_known.isVote());
+    EXPECT_TRUE(msg_known.getBlock().isEmpty());
+    EXPECT_EQ(blockchain::MsgType::SEND, msg_known.getType());
+    EXPECT_EQ(26, msg_known.getProposerId());
+    EXPECT_EQ(7, msg_known.getSequence());
+
+    const blockchain::Vote& vote = msg_known.getVote();
+    EXPECT_EQ(blk_hash, vote.getBlockHash());
+    EXPECT_EQ(26, vote.getValidatorID());
+    EXPECT_EQ(block.getDigest(), vote.getDigest());
+    EXPECT_TRUE(vote.verifySignature(signature1.getPublicKey()));
 }
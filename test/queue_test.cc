@@ -0,0 +1,227 @@
+#include "comms/queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+TEST(QueueTest, PushAndPopAll) {
+    comms::MPSCQueue<std::string> queue;
+    EXPECT_TRUE(queue.empty());
+
+    std::vector<std::string> items;
+    EXPECT_FALSE(queue.popAll(items));
+
+    queue.push("a");
+    queue.push("b");
+    queue.push("c");
+    EXPECT_FALSE(queue.empty());
+    EXPECT_EQ(queue.size(), 3);
+
+    items.push_back("old");
+    EXPECT_TRUE(queue.popAll(items));
+    EXPECT_EQ(items, std::vector<std::string>({"old", "a", "b", "c"}));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.popAll(items));
+}
+
+TEST(QueueTest, Capacity) {
+    comms::MPSCQueue<int> queue(5);
+    EXPECT_EQ(queue.capacity(), 8);
+
+    for (int i = 0; i < 8; i++) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_EQ(queue.size(), 8);
+    EXPECT_FALSE(queue.push(8));
+    EXPECT_EQ(queue.size(), 8);
+
+    // Drained slots can be reused, the ring keeps FIFO order across the wrap
+    std::vector<int> items;
+    EXPECT_TRUE(queue.popAll(items, 3));
+    EXPECT_EQ(items, std::vector<int>({0, 1, 2}));
+    EXPECT_EQ(queue.size(), 5);
+    for (int i = 8; i < 11; i++) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(11));
+
+    items.clear();
+    EXPECT_TRUE(queue.popAll(items));
+    EXPECT_EQ(items, std::vector<int>({3, 4, 5, 6, 7, 8, 9, 10}));
+    EXPECT_EQ(queue.size(), 0);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(QueueTest, PushAll) {
+    comms::MPSCQueue<int> queue(4);
+    std::vector<int> items;
+    EXPECT_EQ(queue.pushAll(items), 0);
+
+    EXPECT_TRUE(queue.push(0));
+    items = {1, 2, 3, 4, 5};
+    // Only the first three fit
+    EXPECT_EQ(queue.pushAll(items), 3);
+    EXPECT_EQ(queue.size(), 4);
+    EXPECT_EQ(queue.pushAll(items), 0);
+
+    std::vector<int> out;
+    EXPECT_TRUE(queue.popAll(out, 2));
+    EXPECT_EQ(out, std::vector<int>({0, 1}));
+
+    // The ring wraps around
+    std::vector<int> rest = {4, 5};
+    EXPECT_EQ(queue.pushAll(rest), 2);
+    EXPECT_TRUE(queue.popAll(out));
+    EXPECT_EQ(out, std::vector<int>({0, 1, 2, 3, 4, 5}));
+}
+
+TEST(QueueTest, MoveOnly) {
+    comms::MPSCQueue<std::unique_ptr<int>> queue(2);
+    EXPECT_TRUE(queue.push(std::unique_ptr<int>(new int(1))));
+    EXPECT_TRUE(queue.push(std::unique_ptr<int>(new int(2))));
+
+    // A rejected item stays with the caller
+    std::unique_ptr<int> rejected(new int(3));
+    EXPECT_FALSE(queue.push(std::move(rejected)));
+    ASSERT_NE(rejected, nullptr);
+    EXPECT_EQ(*rejected, 3);
+
+    std::vector<std::unique_ptr<int>> items;
+    EXPECT_TRUE(queue.popAll(items));
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(*items[0], 1);
+    EXPECT_EQ(*items[1], 2);
+}
+
+TEST(QueueTest, WaitTimeout) {
+    comms::MPSCQueue<int> queue;
+    EXPECT_FALSE(queue.wait(10));
+
+    queue.push(1);
+    EXPECT_TRUE(queue.wait(10));
+    EXPECT_TRUE(queue.wait(-1));
+}
+
+TEST(QueueTest, WakeWithoutItems) {
+    comms::MPSCQueue<int> queue;
+
+    // A wakeup before the wait is not lost
+    queue.wake();
+    EXPECT_FALSE(queue.wait(-1));
+
+    std::thread waker([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.wake();
+    });
+    EXPECT_FALSE(queue.wait(-1));
+    waker.join();
+}
+
+TEST(QueueTest, WaitWakesOnPush) {
+    comms::MPSCQueue<int> queue;
+    std::thread producer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.push(42);
+    });
+    EXPECT_TRUE(queue.wait(-1));
+    producer.join();
+
+    std::vector<int> items;
+    EXPECT_TRUE(queue.popAll(items));
+    EXPECT_EQ(items, std::vector<int>({42}));
+}
+
+TEST(QueueTest, MultipleProducers) {
+    // Small ring so producers regularly find it full & retry
+    comms::MPSCQueue<int> queue(64);
+    const int producers = 4;
+    const int per_producer = 10000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, per_producer]() {
+            for (int i = 0; i < per_producer; i++) {
+                while (!queue.push(p * per_producer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> items;
+    while (items.size() < producers * per_producer) {
+        queue.wait(100);
+        queue.popAll(items, 16);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Items of one producer keep their order
+    std::vector<int> last(producers, -1);
+    for (int item : items) {
+        int p = item / per_producer;
+        EXPECT_GT(item, last[p]);
+        last[p] = item;
+    }
+    EXPECT_EQ(items.size(), producers * per_producer);
+}
+
+TEST(QueueTest, PushWaitBlocksWhileFull) {
+    comms::MPSCQueue<int> queue(2);
+    std::atomic<bool> running{true};
+    EXPECT_TRUE(queue.pushWait(1, running));
+    EXPECT_TRUE(queue.pushWait(2, running));
+
+    // The producer sleeps until the consumer frees a slot
+    std::atomic<bool> pushed{false};
+    std::thread producer([&]() {
+        pushed = queue.pushWait(3, running);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(pushed);
+    std::vector<int> items;
+    EXPECT_TRUE(queue.popAll(items, 1));
+    producer.join();
+    EXPECT_TRUE(pushed);
+
+    // Clearing the flag releases a blocked producer without the item
+    std::thread stopped([&]() {
+        pushed = queue.pushWait(4, running);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    running = false;
+    queue.wakeProducers();
+    stopped.join();
+    EXPECT_FALSE(pushed);
+
+    EXPECT_TRUE(queue.popAll(items));
+    EXPECT_EQ(items, std::vector<int>({1, 2, 3}));
+}
+
+TEST(QueueTest, PushWaitTimesOut) {
+    comms::MPSCQueue<int> queue(2);
+    std::atomic<bool> running{true};
+    EXPECT_TRUE(queue.pushWait(1, running, std::chrono::milliseconds(10)));
+    EXPECT_TRUE(queue.pushWait(2, running, std::chrono::milliseconds(10)));
+
+    // Nobody pops, the producer gives up after the timeout
+    EXPECT_FALSE(queue.pushWait(3, running, std::chrono::milliseconds(10)));
+
+    // A slot freed while waiting lets the item in
+    std::atomic<bool> pushed{false};
+    std::thread producer([&]() {
+        pushed = queue.pushWait(4, running, std::chrono::milliseconds(5000));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<int> items;
+    EXPECT_TRUE(queue.popAll(items, 1));
+    producer.join();
+    EXPECT_TRUE(pushed);
+    EXPECT_TRUE(queue.popAll(items));
+    EXPECT_EQ(items, std::vector<int>({1, 2, 4}));
+}
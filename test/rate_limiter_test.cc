@@ -0,0 +1,45 @@
+#include "comms/rate_limiter.h"
+
+#include <gtest/gtest.h>
+
+TEST(RateLimiterTest, Disabled) {
+    comms::RateLimiter limiter;
+    EXPECT_FALSE(limiter.enabled());
+    EXPECT_EQ(limiter.acquire(1, 1000000), 1000000);
+    EXPECT_EQ(limiter.getLimited(), 0);
+}
+
+TEST(RateLimiterTest, BurstAndRefill) {
+    comms::RateLimiter limiter(10, 5);
+    auto start = std::chrono::steady_clock::now();
+
+    // A new sender may send a full burst
+    EXPECT_EQ(limiter.acquire(1, 3, start), 3);
+    EXPECT_EQ(limiter.acquire(1, 3, start), 2);
+    EXPECT_EQ(limiter.acquire(1, 1, start), 0);
+    EXPECT_EQ(limiter.getLimited(), 2);
+
+    // Other senders have their own bucket
+    EXPECT_EQ(limiter.acquire(2, 5, start), 5);
+
+    // 10 tokens per second, capped at the burst size
+    EXPECT_EQ(limiter.acquire(1, 5, start + std::chrono::milliseconds(200)), 2);
+    EXPECT_EQ(limiter.acquire(1, 10, start + std::chrono::seconds(10)), 5);
+    EXPECT_EQ(limiter.getLimited(), 10);
+}
+
+TEST(RateLimiterTest, Release) {
+    comms::RateLimiter limiter(10, 5);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(limiter.acquire(1, 5, start), 5);
+
+    // Released tokens can be taken again, but never beyond the burst size
+    limiter.release(1, 2);
+    EXPECT_EQ(limiter.acquire(1, 5, start), 2);
+    limiter.release(1, 100);
+    EXPECT_EQ(limiter.acquire(1, 10, start), 5);
+
+    // Releasing for an unknown sender is a no-op
+    limiter.release(2, 3);
+    EXPECT_EQ(limiter.acquire(2, 10, start), 5);
+}
@@ -0,0 +1,136 @@
+#include "comms/reorder.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+// Message tagged with `id` in its sequence field
+blockchain::Message makeMessage(uint64_t id) {
+    return blockchain::Message(blockchain::MsgType::ECHO, blockchain::Vote("block"), 1, 1, 0, id);
+}
+
+std::vector<uint64_t> ids(const std::vector<blockchain::Message>& messages) {
+    std::vector<uint64_t> result;
+    for (const auto& msg : messages) {
+        result.push_back(msg.getSequence());
+    }
+    return result;
+}
+}  // namespace
+
+TEST(ReorderTest, InOrder) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+    buffer.add(1, 7, 1, makeMessage(1), ready);
+    buffer.add(1, 7, 2, makeMessage(2), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({1, 2}));
+    EXPECT_EQ(buffer.pending(), 0);
+}
+
+TEST(ReorderTest, OutOfOrder) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+    buffer.add(1, 7, 1, makeMessage(1), ready);
+    buffer.add(1, 7, 4, makeMessage(4), ready);
+    buffer.add(1, 7, 3, makeMessage(3), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({1}));
+    EXPECT_EQ(buffer.pending(), 2);
+
+    buffer.add(1, 7, 2, makeMessage(2), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({1, 2, 3, 4}));
+    EXPECT_EQ(buffer.pending(), 0);
+
+    // Duplicates are dropped
+    buffer.add(1, 7, 2, makeMessage(2), ready);
+    EXPECT_EQ(ready.size(), 4);
+}
+
+TEST(ReorderTest, StartsMidSession) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+
+    // The messages before seq 5 went to an earlier run of this validator
+    buffer.add(1, 7, 5, makeMessage(5), ready);
+    buffer.add(1, 7, 7, makeMessage(7), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({5}));
+    buffer.add(1, 7, 6, makeMessage(6), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({5, 6, 7}));
+
+    buffer.add(1, 7, 4, makeMessage(4), ready);
+    EXPECT_EQ(ready.size(), 3);
+    EXPECT_EQ(buffer.pending(), 0);
+}
+
+TEST(ReorderTest, Sessions) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+
+    // Senders are ordered independently
+    buffer.add(1, 7, 1, makeMessage(11), ready);
+    buffer.add(1, 7, 3, makeMessage(13), ready);
+    buffer.add(2, 7, 1, makeMessage(21), ready);
+    buffer.add(2, 7, 3, makeMessage(23), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({11, 21}));
+    EXPECT_EQ(buffer.pending(), 2);
+
+    // Unordered messages pass right away
+    buffer.add(1, 7, 0, makeMessage(40), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({11, 21, 40}));
+
+    // A new session of sender 1 supersedes the old one, its held back message is discarded
+    buffer.add(1, 8, 1, makeMessage(31), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({11, 21, 40, 31}));
+    EXPECT_EQ(buffer.pending(), 1);
+
+    buffer.add(2, 7, 2, makeMessage(22), ready);
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({11, 21, 40, 31, 22, 23}));
+    EXPECT_EQ(buffer.pending(), 0);
+}
+
+TEST(ReorderTest, SkipsLostMessage) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+
+    // Message 2 never arrives
+    buffer.add(1, 7, 1, makeMessage(1), ready);
+    for (uint64_t seq = 3; seq <= REORDER_LIMIT_ + 2; seq++) {
+        buffer.add(1, 7, seq, makeMessage(seq), ready);
+    }
+    EXPECT_EQ(ready.size(), 1);
+    EXPECT_EQ(buffer.pending(), REORDER_LIMIT_);
+
+    buffer.add(1, 7, REORDER_LIMIT_ + 4, makeMessage(REORDER_LIMIT_ + 4), ready);
+    ASSERT_EQ(ready.size(), REORDER_LIMIT_ + 1);
+    EXPECT_EQ(ready[1].getSequence(), 3);
+    EXPECT_EQ(ready.back().getSequence(), REORDER_LIMIT_ + 2);
+    EXPECT_EQ(buffer.pending(), 1);
+
+    // A late message 2 is a duplicate now
+    buffer.add(1, 7, 2, makeMessage(2), ready);
+    EXPECT_EQ(ready.size(), REORDER_LIMIT_ + 1);
+}
+
+TEST(ReorderTest, RefusedMessageIsHeldBack) {
+    comms::ReorderBuffer buffer;
+    std::vector<blockchain::Message> ready;
+    bool full = true;
+    auto deliver = [&](blockchain::Message&& msg) {
+        if (full) {
+            return false;
+        }
+        ready.push_back(std::move(msg));
+        return true;
+    };
+
+    // A full queue refuses message 1, message 3 waits behind it & every add tries message 1 again
+    EXPECT_FALSE(buffer.add(1, 7, 1, makeMessage(1), deliver));
+    EXPECT_FALSE(buffer.add(1, 7, 3, makeMessage(3), deliver));
+    EXPECT_EQ(buffer.pending(), 2);
+
+    // The resent message 1 is a duplicate, but hands over everything that is in order
+    full = false;
+    EXPECT_TRUE(buffer.add(1, 7, 1, makeMessage(1), deliver));
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({1}));
+    EXPECT_TRUE(buffer.add(1, 7, 2, makeMessage(2), deliver));
+    EXPECT_EQ(ids(ready), std::vector<uint64_t>({1, 2, 3}));
+    EXPECT_EQ(buffer.pending(), 0);
+}
@@ -69,4 +69,55 @@ TEST(SettingsTest, Getters) {
     EXPECT_EQ(val2, settings2.getMyValidatorInfo());
     EXPECT_EQ("192.168.0.27:50002", settings1.getMyValidatorAddress());
     EXPECT_EQ("192.168.0.27:50002", settings2.getMyValidatorAddress());
+
+    EXPECT_EQ(2, settings1.getPipelineDepth());
+    EXPECT_EQ(4, settings2.getPipelineDepth());
+    EXPECT_FALSE(settings1.getErasureCoding());
+    EXPECT_FALSE(settings2.getErasureCoding());
+    EXPECT_EQ(256, settings1.getGcWatermark());
+    EXPECT_EQ(128, settings2.getGcWatermark());
+    EXPECT_EQ(4, settings1.getServerThreads());
+    EXPECT_EQ(2, settings2.getServerThreads());
+    EXPECT_EQ(20000, settings1.getKeepaliveTimeMs());
+    EXPECT_EQ(10000, settings2.getKeepaliveTimeMs());
+    EXPECT_EQ(5000, settings1.getKeepaliveTimeoutMs());
+    EXPECT_EQ(100, settings1.getReconnectBackoffMinMs());
+    EXPECT_EQ(2000, settings1.getReconnectBackoffMaxMs());
+    EXPECT_EQ(5000, settings2.getReconnectBackoffMaxMs());
+    EXPECT_EQ(16, settings1.getSendWindow());
+    EXPECT_EQ(8, settings2.getSendWindow());
+    EXPECT_EQ(4096, settings1.getTxQueueCapacity());
+    EXPECT_EQ(8192, settings2.getTxQueueCapacity());
+    EXPECT_EQ(100000, settings1.getMempoolCapacity());
+    EXPECT_EQ(64 * 1024 * 1024, settings2.getMempoolMaxBytes());
+    EXPECT_EQ(4, settings1.getVerifyThreads());
+    EXPECT_EQ(2, settings2.getVerifyThreads());
+    EXPECT_EQ(4, settings1.getEventThreads());
+    EXPECT_EQ(2, settings2.getEventThreads());
+    EXPECT_EQ(500, settings1.getProposeIntervalMs());
+    EXPECT_EQ(1000, settings2.getProposeIntervalMs());
+    EXPECT_EQ(1000, settings1.getTxRateLimit());
+    EXPECT_EQ(200, settings1.getTxBurst());
+    EXPECT_EQ(0, settings2.getTxRateLimit());
+    EXPECT_EQ(100, settings2.getTxBurst());
+}
+
+
+TEST(SettingsTest, ErasureCoding) {
+    // Coded dispersal is off in the shipped config, a deployment turns it on in its own config
+    std::ifstream shipped("settings.json");
+    json j = json::parse(shipped);
+    j["erasureCoding"] = true;
+    std::ofstream coded("settings_erasure.json");
+    coded << j.dump(4);
+    coded.close();
+
+    config::Settings settings("settings_erasure.json");
+    EXPECT_TRUE(settings.getErasureCoding());
+    EXPECT_EQ(2, settings.getPipelineDepth());
+    EXPECT_EQ(4, settings.getTotalNumberOfValidators());
+    EXPECT_EQ(1, settings.getNumberOfFaultyValidators());
+
+    settings.setErasureCoding(false);
+    EXPECT_FALSE(settings.getErasureCoding());
 }
@@ -0,0 +1,56 @@
+#include "cryptowallet/tx_pipeline.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+TEST(TxPipelineTest, KeepsOrderPerSender) {
+    const int senders = 4;
+    const int per_sender = 500;
+    std::map<uint16_t, std::vector<uint32_t>> committed;
+    std::thread::id commit_thread;
+    bool single_thread = true;
+
+    // Odd tx ids fail verification but are still committed
+    cryptowallet::TxPipeline pipeline(
+        3, [](const blockchain::Transaction& tx) { return tx.getID() % 2 == 0; },
+        [&](std::vector<cryptowallet::TxPipeline::Verified>& txs) {
+            if (commit_thread == std::thread::id()) {
+                commit_thread = std::this_thread::get_id();
+            }
+            single_thread = single_thread && commit_thread == std::this_thread::get_id();
+            for (auto& verified : txs) {
+                EXPECT_EQ(verified.valid, verified.tx.getID() % 2 == 0);
+                committed[verified.tx.getSenderID()].push_back(verified.tx.getID());
+            }
+        });
+    EXPECT_EQ(pipeline.getNumberOfThreads(), 3);
+
+    for (int i = 0; i < per_sender; i += 50) {
+        std::vector<blockchain::Transaction> txs;
+        for (int j = i; j < i + 50; j++) {
+            for (int s = 0; s < senders; s++) {
+                txs.push_back(blockchain::Transaction(j, s));
+            }
+        }
+        pipeline.Submit(txs);
+    }
+    // Stop() commits everything that was submitted
+    pipeline.Stop();
+
+    EXPECT_TRUE(single_thread);
+    ASSERT_EQ(committed.size(), senders);
+    for (auto& sender : committed) {
+        ASSERT_EQ(sender.second.size(), per_sender);
+        for (int i = 0; i < per_sender; i++) {
+            EXPECT_EQ(sender.second[i], i);
+        }
+    }
+
+    // A stopped pipeline drops new transactions
+    std::vector<blockchain::Transaction> late = {blockchain::Transaction(0, 0)};
+    pipeline.Submit(late);
+    EXPECT_EQ(committed[0].size(), per_sender);
+}
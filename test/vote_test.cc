@@ -0,0 +1,79 @@
+#include "blockchain/vote.h"
+
+#include <chat.grpc.pb.h>
+#include <grpcpp/ext/proto_server_reflection_plugin.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/health_check_service_interface.h>
+#include <gtest/gtest.h>
+
+#include "blockchain/message.h"
+#include "blockchain/output.h"
+#include "signature/hash.h"
+
+blockchain::Block generate_block() {
+    blockchain::Transaction transaction(3001);
+    transaction.addInput(blockchain::Input(2001, 10));
+    transaction.addOutput(blockchain::Output(6, 1001));
+    blockchain::Block block(2, "prevblock");
+    block.addTransaction(transaction);
+    block.finalize();
+    return block;
+}
+
+TEST(VoteTest, SignAndVerify) {
+    blockchain::Block block = generate_block();
+    std::string block_hash = block.getHeader().getID();
+
+    signature::Signature signature1 = signature::Signature::getInstance();
+    signature::Signature signature2 = signature::Signature::getInstance();
+    signature1.KeyGen();
+    signature2.KeyGen();
+
+    blockchain::Vote vote(block_hash);
+    EXPECT_FALSE(vote.isEmpty());
+    vote.sign(signature1.getPrivateKey(), 26, signature2.getPublicKey());
+
+    EXPECT_EQ(block_hash, vote.getBlockHash());
+    EXPECT_EQ(26, vote.getValidatorID());
+    EXPECT_EQ(signature2.getPublicKey(), vote.getValidatorNextPublicKey());
+    EXPECT_TRUE(vote.verifySignature(signature1.getPublicKey()));
+    EXPECT_FALSE(vote.verifySignature(signature2.getPublicKey()));
+
+    // A vote signs the same digest as the block signed by the same validator
+    block.sign(signature1.getPrivateKey(), 26, signature2.getPublicKey());
+    EXPECT_EQ(block.getDigest(), vote.getDigest());
+    EXPECT_EQ(block.getDigest(), blockchain::Block::signingDigest(block_hash, 26, blockchain::Block::keyHash(signature2.getPublicKey())));
+    EXPECT_TRUE(block.verifyMerkleRoot());
+}
+
+TEST(VoteTest, ProtoConvert) {
+    blockchain::Block block = generate_block();
+    std::string block_hash = block.getHeader().getID();
+
+    signature::Signature signature1 = signature::Signature::getInstance();
+    signature::Signature signature2 = signature::Signature::getInstance();
+    signature1.KeyGen();
+    signature2.KeyGen();
+
+    blockchain::Vote vote(block_hash);
+    vote.sign(signature1.getPrivateKey(), 3, signature2.getPublicKey());
+
+    // Vote message carries no block
+    blockchain::Message message(blockchain::MsgType::READY, vote, 3, 2, 0, 7);
+    chat::Message proto_message = message.toProtoMessage();
+    EXPECT_FALSE(proto_message.has_block());
+    EXPECT_TRUE(proto_message.has_vote());
+
+    blockchain::Message rec_message(proto_message);
+    EXPECT_TRUE(rec_message.isVote());
+    EXPECT_TRUE(rec_message.getBlock().isEmpty());
+    EXPECT_EQ(blockchain::MsgType::READY, rec_message.getType());
+    EXPECT_EQ(7, rec_message.getSequence());
+
+    const blockchain::Vote& rec_vote = rec_message.getVote();
+    EXPECT_EQ(block_hash, rec_vote.getBlockHash());
+    EXPECT_EQ(3, rec_vote.getValidatorID());
+    EXPECT_EQ(vote.getValidatorSignature(), rec_vote.getValidatorSignature());
+    EXPECT_EQ(signature2.getPublicKey(), rec_vote.getValidatorNextPublicKey());
+    EXPECT_TRUE(rec_vote.verifySignature(signature1.getPublicKey()));
+}
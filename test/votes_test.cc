@@ -0,0 +1,75 @@
+#include "bracha/votes.h"
+
+#include <gtest/gtest.h>
+
+TEST(VotesTest, AddAndCount) {
+    bracha::VoteTracker votes;
+    EXPECT_TRUE(votes.empty());
+
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::ECHO, 1));
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::ECHO, 2));
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::READY, 1));
+    EXPECT_TRUE(votes.add("block2", bracha::Phase::ECHO, 3));
+    EXPECT_FALSE(votes.empty());
+
+    EXPECT_EQ(votes.count("block1", bracha::Phase::ECHO), 2);
+    EXPECT_EQ(votes.count("block1", bracha::Phase::READY), 1);
+    EXPECT_EQ(votes.count("block2", bracha::Phase::ECHO), 1);
+    EXPECT_EQ(votes.count("block2", bracha::Phase::READY), 0);
+    EXPECT_EQ(votes.count("block3", bracha::Phase::ECHO), 0);
+}
+
+TEST(VotesTest, Duplicates) {
+    bracha::VoteTracker votes;
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::ECHO, 1));
+    EXPECT_FALSE(votes.add("block1", bracha::Phase::ECHO, 1));
+    EXPECT_FALSE(votes.add("block1", bracha::Phase::ECHO, 1));
+    EXPECT_EQ(votes.count("block1", bracha::Phase::ECHO), 1);
+
+    // Same validator can still vote in the other phase
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::READY, 1));
+
+    // Out of range validator ids are rejected
+    EXPECT_FALSE(votes.add("block1", bracha::Phase::ECHO, MAX_VALIDATORS_));
+    EXPECT_EQ(votes.count("block1", bracha::Phase::ECHO), 1);
+}
+
+TEST(VotesTest, Reached) {
+    bracha::VoteTracker votes;
+    EXPECT_EQ(votes.reached(bracha::Phase::ECHO, 1), "");
+
+    votes.add("block1", bracha::Phase::ECHO, 1);
+    votes.add("block2", bracha::Phase::ECHO, 1);
+    votes.add("block2", bracha::Phase::ECHO, 2);
+    votes.add("block2", bracha::Phase::ECHO, 3);
+
+    EXPECT_EQ(votes.reached(bracha::Phase::ECHO, 3), "block2");
+    EXPECT_EQ(votes.reached(bracha::Phase::ECHO, 4), "");
+    EXPECT_EQ(votes.reached(bracha::Phase::READY, 1), "");
+}
+
+TEST(VotesTest, Voters) {
+    bracha::VoteTracker votes;
+    votes.add("block1", bracha::Phase::READY, 0);
+    votes.add("block1", bracha::Phase::READY, 5);
+
+    bracha::VoteSet voters = votes.voters("block1", bracha::Phase::READY);
+    EXPECT_TRUE(voters.test(0));
+    EXPECT_TRUE(voters.test(5));
+    EXPECT_FALSE(voters.test(1));
+    EXPECT_EQ(voters.count(), 2);
+    EXPECT_TRUE(votes.voters("block1", bracha::Phase::ECHO).none());
+    EXPECT_TRUE(votes.voters("block2", bracha::Phase::READY).none());
+}
+
+TEST(VotesTest, Clear) {
+    bracha::VoteTracker votes;
+    votes.add("block1", bracha::Phase::ECHO, 1);
+    votes.add("block1", bracha::Phase::READY, 1);
+    votes.clear();
+
+    EXPECT_TRUE(votes.empty());
+    EXPECT_EQ(votes.count("block1", bracha::Phase::ECHO), 0);
+    EXPECT_EQ(votes.reached(bracha::Phase::READY, 1), "");
+    EXPECT_TRUE(votes.add("block1", bracha::Phase::ECHO, 1));
+}